@@ -0,0 +1,170 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Noise comes from MORSE_NOISE_LANES xorshift32 generators stepped side by
+  side, so the loop is a handful of shifts and xors the compiler turns into
+  vector code. Each sample sums four uniform draws (Irwin-Hall), which is
+  Gaussian to within a few percent and bounded at 3.5 sigma.
+
+  Each fading path is a complex Gaussian tap following an Ornstein-Uhlenbeck
+  process whose corner is the Doppler spread, with unit mean power, so the
+  tap amplitude is Rayleigh distributed. The Watterson model adds a second
+  path of equal power, Doppler shifted by the spread, the two beat against
+  each other. The differential delay of the paths only rotates a single
+  tone, it is part of the second tap.
+*/
+
+#include "gstmorsechannel.h"
+
+#include <math.h>
+#include <string.h>
+
+// sqrt (3/4) / 2^29, four uniforms of +-2^29 scaled to unit variance
+#define MORSE_NOISE_SCALE (0.8660254037844386 / 536870912.0)
+
+// Correlation time of the frequency drift in seconds
+#define MORSE_DRIFT_TIME 30.0
+
+static inline guint32
+morse_xorshift (guint32 x)
+{
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+static gdouble
+morse_channel_gauss (MorseChannel *channel)
+{
+  gint32 acc = 0;
+
+  for (gint r = 0; r < 4; r++) {
+    channel->state[0] = morse_xorshift (channel->state[0]);
+    acc += (gint32) channel->state[0] >> 2;
+  }
+  return acc * MORSE_NOISE_SCALE;
+}
+
+void
+morse_channel_reset (MorseChannel *channel, guint32 seed)
+{
+  memset (channel, 0, sizeof (MorseChannel));
+
+  // Spread the seed over the lanes, xorshift needs a non-zero state
+  for (guint l = 0; l < MORSE_NOISE_LANES; l++) {
+    guint32 z = seed + 0x9e3779b9u * (l + 1);
+
+    z = (z ^ (z >> 16)) * 0x85ebca6bu;
+    z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+    z ^= z >> 16;
+    channel->state[l] = z ? z : 1;
+  }
+
+  for (guint p = 0; p < 2; p++) {
+    channel->path[p][0] = G_SQRT2 / 2 * morse_channel_gauss (channel);
+    channel->path[p][1] = G_SQRT2 / 2 * morse_channel_gauss (channel);
+  }
+  channel->fade = 1.0;
+}
+
+void
+morse_channel_step (MorseChannel *channel, const MorseChannelParams *params,
+    gint rate, guint64 elapsed, guint block)
+{
+  gdouble played = MIN (elapsed, channel->block);
+  gdouble fade = 1.0, turn = 0.0, drift = 0.0;
+  gdouble fade_reached = channel->fade + channel->fade_slope * played;
+  gdouble drift_reached = channel->drift + channel->drift_slope * played;
+  gdouble t = (gdouble) elapsed / rate;
+
+  if (params->fading != GST_MORSE_FADING_NONE && params->fading_rate > 0.0) {
+    gdouble a = exp (-2.0 * G_PI * params->fading_rate * t);
+    gdouble w = sqrt ((1.0 - a * a) / 2.0);
+    gdouble re, im, angle, delta;
+    guint paths = params->fading == GST_MORSE_FADING_WATTERSON ? 2 : 1;
+
+    for (guint p = 0; p < paths; p++) {
+      channel->path[p][0] = a * channel->path[p][0] +
+          w * morse_channel_gauss (channel);
+      channel->path[p][1] = a * channel->path[p][1] +
+          w * morse_channel_gauss (channel);
+    }
+
+    re = channel->path[0][0];
+    im = channel->path[0][1];
+    if (paths == 2) {
+      gdouble c, s;
+
+      channel->rotation = fmod (channel->rotation +
+          2.0 * G_PI * params->fading_rate * t, 2.0 * G_PI);
+      c = cos (channel->rotation);
+      s = sin (channel->rotation);
+      re = (re + c * channel->path[1][0] - s * channel->path[1][1]) / G_SQRT2;
+      im = (im + s * channel->path[1][0] + c * channel->path[1][1]) / G_SQRT2;
+    }
+
+    // The phase the tap turned by is played out as a frequency offset
+    fade = hypot (re, im);
+    angle = atan2 (im, re);
+    delta = remainder (angle - channel->angle, 2.0 * G_PI);
+    turn = block > 0 ? delta / block : 0.0;
+    channel->angle = angle;
+  }
+
+  if (params->drift > 0.0) {
+    gdouble a = exp (-t / MORSE_DRIFT_TIME);
+
+    channel->drift_state = a * channel->drift_state +
+        sqrt (1.0 - a * a) * params->drift * morse_channel_gauss (channel);
+    drift = channel->drift_state;
+  }
+
+  // Glide from where the last buffer ended to the new values
+  channel->block = block;
+  channel->fade = fade_reached;
+  channel->fade_slope = block > 0 ? (fade - fade_reached) / block : 0.0;
+  channel->drift = drift_reached;
+  channel->drift_slope = block > 0 ? (drift - drift_reached) / block : 0.0;
+  channel->turn = turn;
+}
+
+void
+morse_channel_noise (MorseChannel *channel, gdouble *out, gint n,
+    gdouble sigma)
+{
+  guint32 state[MORSE_NOISE_LANES];
+  gdouble scale = sigma * MORSE_NOISE_SCALE;
+
+  memcpy (state, channel->state, sizeof (state));
+
+  for (gint k = 0; k < n; k += MORSE_NOISE_LANES) {
+    gint32 acc[MORSE_NOISE_LANES] = { 0 };
+    gint m = MIN (MORSE_NOISE_LANES, n - k);
+
+    for (gint r = 0; r < 4; r++)
+      for (gint l = 0; l < MORSE_NOISE_LANES; l++) {
+        state[l] = morse_xorshift (state[l]);
+        acc[l] += (gint32) state[l] >> 2;
+      }
+
+    for (gint l = 0; l < m; l++)
+      out[k + l] += acc[l] * scale;
+  }
+
+  memcpy (channel->state, state, sizeof (state));
+}
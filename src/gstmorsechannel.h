@@ -0,0 +1,80 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  HF channel simulation for the morsesrc generators: additive noise, fading
+  and frequency drift. Fading and drift change slowly, they are stepped once
+  per buffer and the generators glide across it like they do for controlled
+  volume and frequency. Noise is added to every tone block in the same pass
+  that shapes it.
+*/
+
+#ifndef __GST_MORSE_CHANNEL_H__
+#define __GST_MORSE_CHANNEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Fading models
+typedef enum {
+  GST_MORSE_FADING_NONE,
+  GST_MORSE_FADING_RAYLEIGH,
+  GST_MORSE_FADING_WATTERSON
+} GstMorseFading;
+
+// Independent generators the noise loop runs side by side
+#define MORSE_NOISE_LANES 8
+
+typedef struct {
+  GstMorseFading fading;
+  gdouble fading_rate;
+  gdouble drift;
+} MorseChannelParams;
+
+// The fade amplitude and drift (Hz) reached at the last step and their
+// slope per sample across the next buffer. `turn` is the frequency offset
+// in radians per sample the fading phase adds over it.
+typedef struct {
+  guint32 state[MORSE_NOISE_LANES];
+  gdouble path[2][2];
+  gdouble rotation;
+  gdouble angle;
+  gdouble drift_state;
+  guint block;
+
+  gdouble fade;
+  gdouble fade_slope;
+  gdouble turn;
+  gdouble drift;
+  gdouble drift_slope;
+} MorseChannel;
+
+void morse_channel_reset (MorseChannel *channel, guint32 seed);
+
+// Advance fading and drift by the `elapsed` samples played since the last
+// step and plan the glide over the next `block` samples
+void morse_channel_step (MorseChannel *channel,
+    const MorseChannelParams *params, gint rate, guint64 elapsed,
+    guint block);
+
+// Add Gaussian noise of standard deviation `sigma` to `n` samples
+void morse_channel_noise (MorseChannel *channel, gdouble *out, gint n,
+    gdouble sigma);
+
+G_END_DECLS
+
+#endif /* __GST_MORSE_CHANNEL_H__ */
@@ -0,0 +1,201 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  The encoder is linked between two unparented pads. Packets and the CAPS
+  event carrying the stream headers arrive on the collecting pad while
+  morse_encoder_push or morse_encoder_end runs. Header buffers are dropped,
+  they are in the caps. So is anything after a second SEGMENT, which is
+  flacenc rewriting its STREAMINFO at EOS.
+*/
+
+#include "gstmorseencode.h"
+
+struct _MorseEncoder {
+  GstElement *element;
+  GstPad *srcpad;
+  GstPad *sinkpad;
+  GstCaps *raw_caps;
+  GstCaps *caps;
+  GQueue packets;
+  guint segments;
+  guint sessions;
+  gboolean open;
+};
+
+static GstFlowReturn
+morse_encoder_chain (GstPad *pad, GstObject *parent G_GNUC_UNUSED,
+    GstBuffer *buffer)
+{
+  MorseEncoder *encoder = gst_pad_get_element_private (pad);
+
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER) ||
+      encoder->segments > 1) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  g_queue_push_tail (&encoder->packets, buffer);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+morse_encoder_event (GstPad *pad, GstObject *parent G_GNUC_UNUSED,
+    GstEvent *event)
+{
+  MorseEncoder *encoder = gst_pad_get_element_private (pad);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+      {
+        GstCaps *caps;
+
+        gst_event_parse_caps (event, &caps);
+        gst_caps_replace (&encoder->caps, caps);
+        break;
+      }
+    case GST_EVENT_SEGMENT:
+      encoder->segments++;
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
+MorseEncoder *
+morse_encoder_new (const gchar *factory, GstCaps *raw_caps)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+  MorseEncoder *encoder;
+  GstPad *sink, *src;
+  gboolean linked;
+
+  if (!element)
+    return NULL;
+
+  encoder = g_new0 (MorseEncoder, 1);
+  encoder->element = gst_object_ref_sink (element);
+  encoder->srcpad = gst_object_ref_sink (gst_pad_new ("src", GST_PAD_SRC));
+  encoder->sinkpad = gst_object_ref_sink (gst_pad_new ("sink", GST_PAD_SINK));
+  encoder->raw_caps = gst_caps_ref (raw_caps);
+  g_queue_init (&encoder->packets);
+
+  gst_pad_set_element_private (encoder->sinkpad, encoder);
+  gst_pad_set_chain_function (encoder->sinkpad, morse_encoder_chain);
+  gst_pad_set_event_function (encoder->sinkpad, morse_encoder_event);
+
+  sink = gst_element_get_static_pad (element, "sink");
+  src = gst_element_get_static_pad (element, "src");
+  linked = sink && src &&
+      gst_pad_link (encoder->srcpad, sink) == GST_PAD_LINK_OK &&
+      gst_pad_link (src, encoder->sinkpad) == GST_PAD_LINK_OK;
+  if (sink)
+    gst_object_unref (sink);
+  if (src)
+    gst_object_unref (src);
+
+  if (!linked) {
+    morse_encoder_free (encoder);
+    return NULL;
+  }
+
+  gst_pad_set_active (encoder->srcpad, TRUE);
+  gst_pad_set_active (encoder->sinkpad, TRUE);
+
+  return encoder;
+}
+
+void
+morse_encoder_free (MorseEncoder *encoder)
+{
+  gst_element_set_state (encoder->element, GST_STATE_NULL);
+  gst_pad_set_active (encoder->srcpad, FALSE);
+  gst_pad_set_active (encoder->sinkpad, FALSE);
+  gst_object_unref (encoder->element);
+  gst_object_unref (encoder->srcpad);
+  gst_object_unref (encoder->sinkpad);
+
+  g_queue_clear_full (&encoder->packets, (GDestroyNotify) gst_buffer_unref);
+  gst_caps_unref (encoder->raw_caps);
+  gst_caps_replace (&encoder->caps, NULL);
+  g_free (encoder);
+}
+
+// A session starts from READY, so the encoder keeps nothing of the last
+static gboolean
+morse_encoder_begin (MorseEncoder *encoder)
+{
+  GstSegment segment;
+  gchar *stream_id;
+
+  if (gst_element_set_state (encoder->element, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE)
+    return FALSE;
+
+  encoder->segments = 0;
+  stream_id = g_strdup_printf ("morsesrc-encoded-%u", encoder->sessions++);
+  gst_pad_push_event (encoder->srcpad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  gst_pad_push_event (encoder->srcpad, gst_event_new_caps (encoder->raw_caps));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (encoder->srcpad, gst_event_new_segment (&segment));
+
+  encoder->open = TRUE;
+  return TRUE;
+}
+
+GstFlowReturn
+morse_encoder_push (MorseEncoder *encoder, GstBuffer *buffer)
+{
+  if (!encoder->open && !morse_encoder_begin (encoder)) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  return gst_pad_push (encoder->srcpad, buffer);
+}
+
+void
+morse_encoder_end (MorseEncoder *encoder)
+{
+  if (!encoder->open)
+    return;
+
+  gst_pad_push_event (encoder->srcpad, gst_event_new_eos ());
+  gst_element_set_state (encoder->element, GST_STATE_READY);
+  encoder->open = FALSE;
+}
+
+gboolean
+morse_encoder_is_open (MorseEncoder *encoder)
+{
+  return encoder->open;
+}
+
+GstBuffer *
+morse_encoder_pop (MorseEncoder *encoder)
+{
+  return g_queue_pop_head (&encoder->packets);
+}
+
+GstCaps *
+morse_encoder_get_caps (MorseEncoder *encoder)
+{
+  return encoder->caps;
+}
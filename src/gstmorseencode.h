@@ -0,0 +1,52 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Encoded output for morsesrc. An encoder element (opusenc, flacenc) is
+  driven directly through a pair of private pads, without a bin or extra
+  threads: raw buffers pushed in come out as packets on the same thread,
+  queued until taken. Each session is a stream of its own, so the packets
+  of one message can be replayed on their own later.
+*/
+
+#ifndef __GST_MORSE_ENCODE_H__
+#define __GST_MORSE_ENCODE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MorseEncoder MorseEncoder;
+
+// NULL when `factory` is not installed
+MorseEncoder *morse_encoder_new (const gchar *factory, GstCaps *raw_caps);
+void morse_encoder_free (MorseEncoder *encoder);
+
+// Raw buffers carry timestamps from the start of the session, which the
+// first push opens. morse_encoder_end drains the encoder and closes it.
+GstFlowReturn morse_encoder_push (MorseEncoder *encoder, GstBuffer *buffer);
+void morse_encoder_end (MorseEncoder *encoder);
+gboolean morse_encoder_is_open (MorseEncoder *encoder);
+
+// The next packet, NULL when none is ready
+GstBuffer *morse_encoder_pop (MorseEncoder *encoder);
+
+// Caps of the packets with their stream headers, NULL before the first
+GstCaps *morse_encoder_get_caps (MorseEncoder *encoder);
+
+G_END_DECLS
+
+#endif /* __GST_MORSE_ENCODE_H__ */
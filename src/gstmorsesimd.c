@@ -0,0 +1,451 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  SSE2/AVX2 (x86) and NEON (aarch64) versions of the morsesrc sample kernels.
+  The x86 kernels are compiled with per-function target attributes so the
+  plugin itself needs no special compiler flags, and AVX2 is only used when
+  the CPU reports it at runtime.
+
+  The kernels are bit-exact with the scalar CW_GENERATOR: the envelope comes
+  from the same table, gain and envelope are multiplied in the same order and
+  the float to integer conversions truncate like a C cast.
+*/
+
+#include "gstmorsesimd.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MORSE_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MORSE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Split the block [first, first + n) of an element into the fade-in part
+// (k < *in_end), the flat part and the fade-out part (k >= *out_start),
+// using the same bounds as the scalar generator. The envelope of block
+// sample k is envelope[up + k] while fading in, envelope[down + k] while
+// fading out.
+static inline void
+morse_envelope_split (gint first, gint n, gint samples, gint fade,
+    gint *in_end, gint *out_start, gint *up, gint *down)
+{
+  *in_end = CLAMP (fade - first, 0, n);
+  *out_start = CLAMP (samples - fade + 1 - first, 0, n);
+  *up = first;
+  *down = first - samples + 2 * fade;
+}
+
+// Scalar tails shared by every instruction set
+#define MORSE_SHAPE_TAIL(k, end, base)                                 \
+  for (; k < end; k++)                                                 \
+    tone[k] = gain * envelope[(base) + k] * tone[k]
+
+#define MORSE_STORE_TAIL(sample_t, k)                                  \
+  for (; k < n; k++) {                                                 \
+    sample_t s = tone[k];                                              \
+    for (gint j = 0; j < channels; j++)                                \
+      out[k * channels + j] = s;                                       \
+  }
+
+#ifdef MORSE_SIMD_X86
+
+#define MORSE_SSE2 __attribute__ ((target ("sse2")))
+#define MORSE_AVX2 __attribute__ ((target ("avx2")))
+
+MORSE_SSE2 static void
+morse_shape_sse2 (gdouble *tone, gint n, gint first, gint samples,
+    const gdouble *envelope, gint fade, gdouble gain)
+{
+  gint k = 0, in_end, out_start, up, down;
+  __m128d vgain = _mm_set1_pd (gain);
+
+  morse_envelope_split (first, n, samples, fade, &in_end, &out_start, &up,
+      &down);
+
+  for (; k + 2 <= in_end; k += 2)
+    _mm_storeu_pd (tone + k, _mm_mul_pd (_mm_mul_pd (vgain,
+                _mm_loadu_pd (envelope + up + k)), _mm_loadu_pd (tone + k)));
+  MORSE_SHAPE_TAIL (k, in_end, up);
+
+  for (; k + 2 <= out_start; k += 2)
+    _mm_storeu_pd (tone + k, _mm_mul_pd (vgain, _mm_loadu_pd (tone + k)));
+  for (; k < out_start; k++)
+    tone[k] = gain * tone[k];
+
+  for (; k + 2 <= n; k += 2)
+    _mm_storeu_pd (tone + k, _mm_mul_pd (_mm_mul_pd (vgain,
+                _mm_loadu_pd (envelope + down + k)), _mm_loadu_pd (tone + k)));
+  MORSE_SHAPE_TAIL (k, n, down);
+}
+
+MORSE_AVX2 static void
+morse_shape_avx2 (gdouble *tone, gint n, gint first, gint samples,
+    const gdouble *envelope, gint fade, gdouble gain)
+{
+  gint k = 0, in_end, out_start, up, down;
+  __m256d vgain = _mm256_set1_pd (gain);
+
+  morse_envelope_split (first, n, samples, fade, &in_end, &out_start, &up,
+      &down);
+
+  for (; k + 4 <= in_end; k += 4)
+    _mm256_storeu_pd (tone + k, _mm256_mul_pd (_mm256_mul_pd (vgain,
+                _mm256_loadu_pd (envelope + up + k)),
+            _mm256_loadu_pd (tone + k)));
+  MORSE_SHAPE_TAIL (k, in_end, up);
+
+  for (; k + 4 <= out_start; k += 4)
+    _mm256_storeu_pd (tone + k,
+        _mm256_mul_pd (vgain, _mm256_loadu_pd (tone + k)));
+  for (; k < out_start; k++)
+    tone[k] = gain * tone[k];
+
+  for (; k + 4 <= n; k += 4)
+    _mm256_storeu_pd (tone + k, _mm256_mul_pd (_mm256_mul_pd (vgain,
+                _mm256_loadu_pd (envelope + down + k)),
+            _mm256_loadu_pd (tone + k)));
+  MORSE_SHAPE_TAIL (k, n, down);
+}
+
+// Convert four doubles, truncating like a C cast (integers) or rounding to
+// nearest (floats).
+MORSE_SSE2 static inline __m128i
+morse_cvt4_i32_sse2 (const gdouble *p)
+{
+  return _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (_mm_loadu_pd (p)),
+      _mm_cvttpd_epi32 (_mm_loadu_pd (p + 2)));
+}
+
+MORSE_SSE2 static inline __m128
+morse_cvt4_f32_sse2 (const gdouble *p)
+{
+  return _mm_movelh_ps (_mm_cvtpd_ps (_mm_loadu_pd (p)),
+      _mm_cvtpd_ps (_mm_loadu_pd (p + 2)));
+}
+
+MORSE_AVX2 static inline __m128i
+morse_cvt4_i32_avx2 (const gdouble *p)
+{
+  return _mm256_cvttpd_epi32 (_mm256_loadu_pd (p));
+}
+
+MORSE_AVX2 static inline __m128
+morse_cvt4_f32_avx2 (const gdouble *p)
+{
+  return _mm256_cvtpd_ps (_mm256_loadu_pd (p));
+}
+
+// Mono and stereo blocks are written with vector stores, wider layouts
+// convert four samples at a time and scatter them to the channels.
+#define MORSE_X86_STORE_FUNCS(isa, attr)                               \
+attr static void                                                       \
+morse_store_s16_##isa (gpointer dst, const gdouble *tone, gint n,      \
+    gint channels)                                                     \
+{                                                                      \
+  gint16 *out = dst;                                                   \
+  gint k = 0;                                                          \
+                                                                       \
+  if (channels == 1) {                                                 \
+    for (; k + 8 <= n; k += 8)                                         \
+      _mm_storeu_si128 ((__m128i *) (out + k),                         \
+          _mm_packs_epi32 (morse_cvt4_i32_##isa (tone + k),            \
+              morse_cvt4_i32_##isa (tone + k + 4)));                   \
+  } else if (channels == 2) {                                          \
+    for (; k + 4 <= n; k += 4) {                                       \
+      __m128i v = morse_cvt4_i32_##isa (tone + k);                     \
+      v = _mm_packs_epi32 (v, v);                                      \
+      _mm_storeu_si128 ((__m128i *) (out + 2 * k),                     \
+          _mm_unpacklo_epi16 (v, v));                                  \
+    }                                                                  \
+  } else {                                                             \
+    for (; k + 4 <= n; k += 4) {                                       \
+      gint32 s[4];                                                     \
+      _mm_storeu_si128 ((__m128i *) s, morse_cvt4_i32_##isa (tone + k)); \
+      for (gint l = 0; l < 4; l++)                                     \
+        for (gint j = 0; j < channels; j++)                            \
+          out[(k + l) * channels + j] = s[l];                          \
+    }                                                                  \
+  }                                                                    \
+  MORSE_STORE_TAIL (gint16, k);                                        \
+}                                                                      \
+                                                                       \
+attr static void                                                       \
+morse_store_s32_##isa (gpointer dst, const gdouble *tone, gint n,      \
+    gint channels)                                                     \
+{                                                                      \
+  gint32 *out = dst;                                                   \
+  gint k = 0;                                                          \
+                                                                       \
+  if (channels == 1) {                                                 \
+    for (; k + 4 <= n; k += 4)                                         \
+      _mm_storeu_si128 ((__m128i *) (out + k),                         \
+          morse_cvt4_i32_##isa (tone + k));                            \
+  } else if (channels == 2) {                                          \
+    for (; k + 4 <= n; k += 4) {                                       \
+      __m128i v = morse_cvt4_i32_##isa (tone + k);                     \
+      _mm_storeu_si128 ((__m128i *) (out + 2 * k),                     \
+          _mm_unpacklo_epi32 (v, v));                                  \
+      _mm_storeu_si128 ((__m128i *) (out + 2 * k + 4),                 \
+          _mm_unpackhi_epi32 (v, v));                                  \
+    }                                                                  \
+  } else {                                                             \
+    for (; k + 4 <= n; k += 4) {                                       \
+      gint32 s[4];                                                     \
+      _mm_storeu_si128 ((__m128i *) s, morse_cvt4_i32_##isa (tone + k)); \
+      for (gint l = 0; l < 4; l++)                                     \
+        for (gint j = 0; j < channels; j++)                            \
+          out[(k + l) * channels + j] = s[l];                          \
+    }                                                                  \
+  }                                                                    \
+  MORSE_STORE_TAIL (gint32, k);                                        \
+}                                                                      \
+                                                                       \
+attr static void                                                       \
+morse_store_f32_##isa (gpointer dst, const gdouble *tone, gint n,      \
+    gint channels)                                                     \
+{                                                                      \
+  gfloat *out = dst;                                                   \
+  gint k = 0;                                                          \
+                                                                       \
+  if (channels == 1) {                                                 \
+    for (; k + 4 <= n; k += 4)                                         \
+      _mm_storeu_ps (out + k, morse_cvt4_f32_##isa (tone + k));        \
+  } else if (channels == 2) {                                          \
+    for (; k + 4 <= n; k += 4) {                                       \
+      __m128 v = morse_cvt4_f32_##isa (tone + k);                      \
+      _mm_storeu_ps (out + 2 * k, _mm_unpacklo_ps (v, v));             \
+      _mm_storeu_ps (out + 2 * k + 4, _mm_unpackhi_ps (v, v));         \
+    }                                                                  \
+  } else {                                                             \
+    for (; k + 4 <= n; k += 4) {                                       \
+      gfloat s[4];                                                     \
+      _mm_storeu_ps (s, morse_cvt4_f32_##isa (tone + k));              \
+      for (gint l = 0; l < 4; l++)                                     \
+        for (gint j = 0; j < channels; j++)                            \
+          out[(k + l) * channels + j] = s[l];                          \
+    }                                                                  \
+  }                                                                    \
+  MORSE_STORE_TAIL (gfloat, k);                                        \
+}
+
+MORSE_X86_STORE_FUNCS (sse2, MORSE_SSE2)
+MORSE_X86_STORE_FUNCS (avx2, MORSE_AVX2)
+
+// Doubles need no conversion, so one SSE2 version serves both tables
+MORSE_SSE2 static void
+morse_store_f64_sse2 (gpointer dst, const gdouble *tone, gint n,
+    gint channels)
+{
+  gdouble *out = dst;
+  gint k = 0;
+
+  if (channels == 1) {
+    memcpy (out, tone, n * sizeof (gdouble));
+    return;
+  } else if (channels == 2) {
+    for (; k + 2 <= n; k += 2) {
+      __m128d v = _mm_loadu_pd (tone + k);
+      _mm_storeu_pd (out + 2 * k, _mm_unpacklo_pd (v, v));
+      _mm_storeu_pd (out + 2 * k + 2, _mm_unpackhi_pd (v, v));
+    }
+  }
+  MORSE_STORE_TAIL (gdouble, k);
+}
+
+static const GstMorseKernels morse_kernels_sse2 = {
+  GST_MORSE_SIMD_SSE2, "sse2",
+  morse_shape_sse2,
+  morse_store_s16_sse2, morse_store_s32_sse2,
+  morse_store_f32_sse2, morse_store_f64_sse2
+};
+
+static const GstMorseKernels morse_kernels_avx2 = {
+  GST_MORSE_SIMD_AVX2, "avx2",
+  morse_shape_avx2,
+  morse_store_s16_avx2, morse_store_s32_avx2,
+  morse_store_f32_avx2, morse_store_f64_sse2
+};
+
+#endif /* MORSE_SIMD_X86 */
+
+#ifdef MORSE_SIMD_NEON
+
+static void
+morse_shape_neon (gdouble *tone, gint n, gint first, gint samples,
+    const gdouble *envelope, gint fade, gdouble gain)
+{
+  gint k = 0, in_end, out_start, up, down;
+  float64x2_t vgain = vdupq_n_f64 (gain);
+
+  morse_envelope_split (first, n, samples, fade, &in_end, &out_start, &up,
+      &down);
+
+  for (; k + 2 <= in_end; k += 2)
+    vst1q_f64 (tone + k, vmulq_f64 (vmulq_f64 (vgain,
+                vld1q_f64 (envelope + up + k)), vld1q_f64 (tone + k)));
+  MORSE_SHAPE_TAIL (k, in_end, up);
+
+  for (; k + 2 <= out_start; k += 2)
+    vst1q_f64 (tone + k, vmulq_f64 (vgain, vld1q_f64 (tone + k)));
+  for (; k < out_start; k++)
+    tone[k] = gain * tone[k];
+
+  for (; k + 2 <= n; k += 2)
+    vst1q_f64 (tone + k, vmulq_f64 (vmulq_f64 (vgain,
+                vld1q_f64 (envelope + down + k)), vld1q_f64 (tone + k)));
+  MORSE_SHAPE_TAIL (k, n, down);
+}
+
+static inline int32x4_t
+morse_cvt4_i32_neon (const gdouble *p)
+{
+  return vcombine_s32 (vmovn_s64 (vcvtq_s64_f64 (vld1q_f64 (p))),
+      vmovn_s64 (vcvtq_s64_f64 (vld1q_f64 (p + 2))));
+}
+
+static inline float32x4_t
+morse_cvt4_f32_neon (const gdouble *p)
+{
+  return vcombine_f32 (vcvt_f32_f64 (vld1q_f64 (p)),
+      vcvt_f32_f64 (vld1q_f64 (p + 2)));
+}
+
+static void
+morse_store_s16_neon (gpointer dst, const gdouble *tone, gint n,
+    gint channels)
+{
+  gint16 *out = dst;
+  gint k = 0;
+
+  if (channels == 1) {
+    for (; k + 8 <= n; k += 8)
+      vst1q_s16 (out + k, vcombine_s16 (
+              vqmovn_s32 (morse_cvt4_i32_neon (tone + k)),
+              vqmovn_s32 (morse_cvt4_i32_neon (tone + k + 4))));
+  } else if (channels == 2) {
+    for (; k + 4 <= n; k += 4) {
+      int16x4x2_t v;
+      v.val[0] = v.val[1] = vqmovn_s32 (morse_cvt4_i32_neon (tone + k));
+      vst2_s16 (out + 2 * k, v);
+    }
+  }
+  MORSE_STORE_TAIL (gint16, k);
+}
+
+static void
+morse_store_s32_neon (gpointer dst, const gdouble *tone, gint n,
+    gint channels)
+{
+  gint32 *out = dst;
+  gint k = 0;
+
+  if (channels == 1) {
+    for (; k + 4 <= n; k += 4)
+      vst1q_s32 (out + k, morse_cvt4_i32_neon (tone + k));
+  } else if (channels == 2) {
+    for (; k + 4 <= n; k += 4) {
+      int32x4x2_t v;
+      v.val[0] = v.val[1] = morse_cvt4_i32_neon (tone + k);
+      vst2q_s32 (out + 2 * k, v);
+    }
+  }
+  MORSE_STORE_TAIL (gint32, k);
+}
+
+static void
+morse_store_f32_neon (gpointer dst, const gdouble *tone, gint n,
+    gint channels)
+{
+  gfloat *out = dst;
+  gint k = 0;
+
+  if (channels == 1) {
+    for (; k + 4 <= n; k += 4)
+      vst1q_f32 (out + k, morse_cvt4_f32_neon (tone + k));
+  } else if (channels == 2) {
+    for (; k + 4 <= n; k += 4) {
+      float32x4x2_t v;
+      v.val[0] = v.val[1] = morse_cvt4_f32_neon (tone + k);
+      vst2q_f32 (out + 2 * k, v);
+    }
+  }
+  MORSE_STORE_TAIL (gfloat, k);
+}
+
+static void
+morse_store_f64_neon (gpointer dst, const gdouble *tone, gint n,
+    gint channels)
+{
+  gdouble *out = dst;
+  gint k = 0;
+
+  if (channels == 1) {
+    memcpy (out, tone, n * sizeof (gdouble));
+    return;
+  } else if (channels == 2) {
+    for (; k + 2 <= n; k += 2) {
+      float64x2x2_t v;
+      v.val[0] = v.val[1] = vld1q_f64 (tone + k);
+      vst2q_f64 (out + 2 * k, v);
+    }
+  }
+  MORSE_STORE_TAIL (gdouble, k);
+}
+
+static const GstMorseKernels morse_kernels_neon = {
+  GST_MORSE_SIMD_NEON, "neon",
+  morse_shape_neon,
+  morse_store_s16_neon, morse_store_s32_neon,
+  morse_store_f32_neon, morse_store_f64_neon
+};
+
+#endif /* MORSE_SIMD_NEON */
+
+const GstMorseKernels *
+gst_morse_kernels_get (GstMorseSimd simd)
+{
+#ifdef MORSE_SIMD_X86
+  gboolean have_sse2, have_avx2;
+
+  __builtin_cpu_init ();
+  have_sse2 = __builtin_cpu_supports ("sse2");
+  have_avx2 = __builtin_cpu_supports ("avx2");
+
+  switch (simd) {
+    case GST_MORSE_SIMD_AUTO:
+      if (have_avx2)
+        return &morse_kernels_avx2;
+      return have_sse2 ? &morse_kernels_sse2 : NULL;
+    case GST_MORSE_SIMD_SSE2:
+      return have_sse2 ? &morse_kernels_sse2 : NULL;
+    case GST_MORSE_SIMD_AVX2:
+      return have_avx2 ? &morse_kernels_avx2 : NULL;
+    default:
+      return NULL;
+  }
+#elif defined(MORSE_SIMD_NEON)
+  if (simd == GST_MORSE_SIMD_AUTO || simd == GST_MORSE_SIMD_NEON)
+    return &morse_kernels_neon;
+  return NULL;
+#else
+  (void) simd;
+  return NULL;
+#endif
+}
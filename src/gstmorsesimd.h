@@ -0,0 +1,68 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Vectorised sample kernels used by the morsesrc generators. A generator renders
+  a mono block of tone samples, `shape` applies gain and the envelope table to it
+  in place and `store` converts the block to the output sample type while
+  copying it to every channel. The scalar CW_GENERATOR in gstmorsesrc.c is the
+  reference these kernels must match.
+*/
+
+#ifndef __GST_MORSE_SIMD_H__
+#define __GST_MORSE_SIMD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Instruction sets the kernels can be built for
+typedef enum {
+  GST_MORSE_SIMD_AUTO,
+  GST_MORSE_SIMD_NONE,
+  GST_MORSE_SIMD_SSE2,
+  GST_MORSE_SIMD_AVX2,
+  GST_MORSE_SIMD_NEON
+} GstMorseSimd;
+
+// Apply gain * envelope to `n` samples, tone[0] being sample `first` of an
+// element `samples` long with `fade` samples of ramp on each side.
+// `envelope` holds 2 * fade values, the rise from 0 followed by the fall
+// from 1.0, so each part of the element is a plain multiply.
+typedef void (*MorseShapeFunc) (gdouble *tone, gint n, gint first,
+    gint samples, const gdouble *envelope, gint fade, gdouble gain);
+
+// Convert `n` shaped samples and write each of them to `channels` channels
+typedef void (*MorseStoreFunc) (gpointer dst, const gdouble *tone, gint n,
+    gint channels);
+
+typedef struct {
+  GstMorseSimd simd;
+  const gchar *name;
+  MorseShapeFunc shape;
+  MorseStoreFunc store_s16;
+  MorseStoreFunc store_s32;
+  MorseStoreFunc store_f32;
+  MorseStoreFunc store_f64;
+} GstMorseKernels;
+
+// Return the kernels for `simd`, picking the best one the CPU supports for
+// GST_MORSE_SIMD_AUTO. NULL means the scalar generators should be used.
+const GstMorseKernels *gst_morse_kernels_get (GstMorseSimd simd);
+
+G_END_DECLS
+
+#endif /* __GST_MORSE_SIMD_H__ */
@@ -23,35 +23,27 @@
   USAGE:
   gst-launch-1.0 morsesrc text="CQ CQ DE VK3DG" ! autoaudiosink
   gst-launch-1.0 morsesrc text="CQ CQ DE VK3DG" one-shot=true ! autoaudiosink
+  gst-launch-1.0 filesrc location=bulletin.txt ! m.sink morsesrc name=m ! autoaudiosink
+  gst-launch-1.0 morsesrc text="ПРИВЕТ <SK>" table-file=data/cyrillic.txt ! autoaudiosink
+  gst-launch-1.0 morsesrc text="CQ TEST" volume=0.2 noise=true snr=3 fading=watterson chirp=30 ! autoaudiosink
+  gst-launch-1.0 morsesrc voices="voice, text=VK3DG, frequency=600, pan=-0.7, repeat=true; voice, text=VK3RGL, frequency=750, wpm=25, pan=0.7, repeat=true" ! autoaudiosink
  
-The morse table lookup table method is a compact and efficient way to store the Morse code sequences for all the ASCII characters by
-mapping each ASCII character to their corresponding Morse code sequences. 
+The code table lookup method is a compact and efficient way to store the Morse code sequences by
+mapping each character to its corresponding Morse code sequence.
 
 Here's how it works:
-Table Structure: 
-	The table is an array of 128 unsigned short integers, where each index corresponds to an ASCII character code.
-ASCII Character Codes:
-	The table covers the first 128 ASCII character codes, which include all the printable characters (letters, digits, punctuation, etc.) and some non-printable characters (control characters).
-Morse Code Representation: 
-	Each entry in the table represents a Morse code sequence as a binary number. The binary number is encoded in a specific format:
-	The high 3 bits (bits 6-8) represent the number of symbols (dots or dashes) in the Morse code sequence. If this value is 0, it means the sequence has 8 symbols.
-	The low 7 bits (bits 0-6) represent the actual Morse code sequence, where:
+Table Source:
+	The built-in table is generated at build time by tools/gen-morse-table.py from data/morse-table.txt,
+	one character and its code per line, e.g. "A .-" or "<SK> ...-.-". Set "table-file" to load another
+	file in the same format (e.g. data/cyrillic.txt) on top of it.
+Morse Code Representation:
+	Each entry holds the number of symbols and the symbols themselves as bits, sent from bit 0 up, where:
 	0 represents a dot (.)
 	1 represents a dash (-)
-Example: 
-	Let's take the character 'A' (ASCII code 65) as an example. The corresponding entry in the morse table is 0412. Breaking it down:
-	High 3 bits: 04 ( binary 0100) means the sequence has 4 symbols.
-	Low 7 bits: 12 (binary 00010010) represents the Morse code sequence: .- (dot-dash).
 Lookup:
-	When the code needs to convert a character to Morse code, it looks up the corresponding entry in the morse table using the ASCII character code as the index.
-	It then extracts the Morse code sequence from the entry and uses it to generate the Morse code.
-	Here's a step-by-step example of how the code uses the morse table to convert a character to Morse code:
-
-	1. Get the ASCII character code of the character to convert (e.g., 'A' = 65).
-	2. Look up the corresponding entry in the morse table using the ASCII character code as the index (e.g., morse_table[65] = 0412).
-	3. Extract the number of symbols from the high 3 bits (e.g., 04 = 4 symbols).
-	4. Extract the Morse code sequence from the low 7 bits (e.g., 12 = .-).
-	5. Generate the Morse code sequence using the extracted information (e.g., .- for the character 'A').
+	Text is read as UTF-8. ASCII characters index a 128 entry array directly, other characters and
+	prosigns written as <SK>, <AR> etc. are binary searched. Letters are matched regardless of case,
+	characters without a code are skipped and any whitespace is a word gap.
 
 
   VERSION CONTROL
@@ -59,6 +51,38 @@ Lookup:
   V1.1.0 Added "about-to-finish" message to gstremaer bus similar to uridecodebin to notify end of buffer to avoid EOS and killing pipeline.
          Added "value validation and clamping for all parameters."
   V1.2.0 Added one-shot mode, improved thread safety, better error handling, and audio envelope shaping.
+  V1.3.0 Added "oscillator" property selecting the tone engine (sin, wavetable or recursive phasor).
+         Added SSE2/AVX2/NEON sample kernels selected at caps negotiation, see "simd" property.
+         Added "symbol-cache" to copy pre-rendered dit/dah/gap blocks instead of generating them.
+         Output buffers come from a negotiated GstBufferPool, packed formats use a per-caps scratch area.
+         Added "samples-per-buffer" and "buffer-time", honour blocksize and answer LATENCY queries.
+         Elements are split across buffers instead of being truncated at the buffer end.
+         Added "is-live" clock synchronised mode sized by "latency-time", new text starts at the next element.
+         Added "push-text" action signal feeding a lock-free message queue, see "queue-mode".
+         Text is encoded to a packed run-length stream of key-down/key-up runs instead of an ASCII string.
+         Encoding runs incrementally in a bounded window ahead of playback.
+         Added a "sink" request pad taking text/x-raw buffers, encoded in place with back-pressure.
+         Answer DURATION/POSITION/SEEKING queries and seek in TIME format through a checkpoint index.
+         Timestamps and offsets derive from a 64-bit sample counter, gaps carry the fractional dot length.
+         Added tools/morsebatch, renders job lists to files on a worker pool faster than realtime.
+         Added "voices", independent messages with their own tone, speed, volume and pan mixed in one pass.
+         Added "shared-cache", a process-wide LRU of rendered messages pushed as zero-copy sub-buffers.
+         Added tools/morsebench throughput benchmark and the read-only "allocations" counter it reports.
+         Added a lock-free "stats" structure and the "morsestats" tracer logging it per pushed buffer.
+         Packed, unsigned and byte-swapped formats are generated in place, packfunc is only a fallback.
+         Added "gap-mode", silence is sent as GAP flagged buffers of one pre-filled block or GAP events.
+         Added "keying-messages" posting sample-accurate key-down/key-up, "render-audio" to skip the audio.
+         Added "rise-time" and "envelope" (linear/raised-cosine/blackman), ramps come from lookup tables.
+         Added "high-speed" up to 10000 WPM on an exact dot grid, and "farnsworth-wpm" letter/word spacing.
+         Code table generated at build time, UTF-8 text, <PROSIGN> tokens and "table-file" alternate tables.
+         "frequency", "volume" and "wpm" are controllable, volume and frequency glide per tone block.
+         Added channel simulation in the generator pass: "noise"/"snr", "fading", "chirp" and "drift".
+         Added "one-shot-mode" ready/eos/wait, READY goes through gst_element_call_async, no main loop needed.
+         "about-to-finish" is posted "about-to-finish-time" before the end to the sample, "gapless" chains messages.
+         Added "render-pool", a process-wide worker pool renders "render-ahead" buffers for every element.
+         Added audio/x-opus and audio/x-flac output, FLAC messages are encoded once and replayed from the shared cache,
+         Opus is encoded as it plays.
+         Block sizes are capped so byte counts cannot wrap, morsebench gained --verify and --stress.
 */
 
 #include <gst/gst.h>
@@ -66,11 +90,15 @@ Lookup:
 #include <gst/audio/audio.h>
 #include <gst/base/gstpushsrc.h>
 #include <math.h>
-#include <ctype.h>
 #include "config.h"
+#include "gstmorsechannel.h"
+#include "gstmorseencode.h"
+#include "gstmorsesimd.h"
+#include "gstmorsetable.h"
+#include "gstmorsetracer.h"
 
 // Define plugin package name etc
-#define PACKAGE_VERSION "1.2.0" 
+#define PACKAGE_VERSION "1.3.0" 
 #define GST_LICENSE "LGPL"
 #define GST_PACKAGE_NAME "GStreamer Morse Source"
 #define GST_PACKAGE_ORIGIN "https://github.com/TVforME/morsesrc"
@@ -97,6 +125,91 @@ Lookup:
 #define MAX_VOLUME 1.0         // Full volume
 #define MIN_WPM 5             // 5 WPM minimum (very slow)
 #define MAX_WPM 30            // 30 WPM maximum (very fast)
+#define MAX_HSCW_WPM 10000    // 10000 WPM maximum with high-speed
+#define MIN_DOT_SAMPLES 100   // Shortest dot, in samples
+#define MIN_HSCW_DOT_SAMPLES 2  // Shortest dot with high-speed
+
+// Define the default high-speed mode and Farnsworth speed (0 is off)
+#define DEFAULT_HIGH_SPEED FALSE
+#define DEFAULT_FARNSWORTH_WPM 0
+
+// Define the default tone engine
+#define DEFAULT_OSCILLATOR GST_MORSE_OSCILLATOR_SIN
+
+// Define the default sample kernels
+#define DEFAULT_SIMD GST_MORSE_SIMD_AUTO
+
+// Define the default for the pre-rendered symbol cache
+#define DEFAULT_SYMBOL_CACHE FALSE
+
+// Define the default keying envelope, a 20ms linear ramp
+#define DEFAULT_RISE_TIME (20 * GST_MSECOND)
+#define DEFAULT_ENVELOPE GST_MORSE_ENVELOPE_LINEAR
+
+// Define the channel simulation defaults, everything off
+#define DEFAULT_NOISE FALSE
+#define DEFAULT_SNR 10.0
+#define DEFAULT_FADING GST_MORSE_FADING_NONE
+#define DEFAULT_FADING_RATE 0.5
+#define DEFAULT_CHIRP 0.0
+#define DEFAULT_DRIFT 0.0
+#define DEFAULT_SEED 0
+
+// Define the default number of samples per output buffer
+#define DEFAULT_SAMPLES_PER_BUFFER (5292 * 10)
+
+// Define the default buffer duration, 0 means use samples-per-buffer
+#define DEFAULT_BUFFER_TIME 0
+
+// Define the default live mode and its buffer duration (20ms)
+#define DEFAULT_IS_LIVE FALSE
+#define DEFAULT_LATENCY_TIME (20 * GST_MSECOND)
+
+// Define the default handling of queued messages
+#define DEFAULT_QUEUE_MODE GST_MORSE_QUEUE_MODE_REPLACE
+
+// Define the default warning time before the end of a message
+#define DEFAULT_ABOUT_TO_FINISH_TIME GST_SECOND
+
+// Define the default message chaining, a new timeline per message
+#define DEFAULT_GAPLESS FALSE
+
+// Define the default end of a one-shot message
+#define DEFAULT_ONE_SHOT_MODE GST_MORSE_ONE_SHOT_MODE_READY
+
+// Define the default handling of silent stretches
+#define DEFAULT_GAP_MODE GST_MORSE_GAP_MODE_NONE
+
+// Define the default keying output, audio only
+#define DEFAULT_KEYING_MESSAGES FALSE
+#define DEFAULT_RENDER_AUDIO TRUE
+
+// Define the default process-wide render cache use and budget (16 MiB)
+#define DEFAULT_SHARED_CACHE FALSE
+#define DEFAULT_SHARED_CACHE_SIZE (16 * 1024 * 1024)
+
+// Define the default rendering, on the element's own streaming thread, and
+// the buffers a pool worker renders ahead
+#define DEFAULT_RENDER_POOL FALSE
+#define DEFAULT_RENDER_AHEAD 4
+
+// Messages the text queue holds (power of two)
+#define MORSE_TEXT_QUEUE_SIZE 64
+
+// Mono tone samples rendered per block before fanning out to the channels
+#define MORSE_TONE_BLOCK 256
+
+// Envelope tables kept per element, one per distinct ramp length
+#define MORSE_ENVELOPE_SLOTS 8
+
+// Bandwidth "snr" is measured in, as usual for HF signals
+#define MORSE_NOISE_BANDWIDTH 2500.0
+
+// Time constant a chirping transmitter settles on its frequency with
+#define MORSE_CHIRP_TIME (15.0 / 1000.0)
+
+// Wavetable length (power of two), one guard entry is added for interpolation
+#define MORSE_WAVETABLE_SIZE 4096
 
 // Define the supported audio formats
 #define FORMAT_STR  " { S16LE, S16BE, U16LE, U16BE, "	\
@@ -109,36 +222,350 @@ Lookup:
   "S8, U8 }"
 
 
-static unsigned short morse_table[128] = {
-  /*00 */ 0000, 0000, 0000, 0000, 0000, 0000, 0000, 0000,
-  /*08 */ 0000, 0000, 0412, 0000, 0000, 0412, 0000, 0000,
-  /*10 */ 0000, 0000, 0000, 0000, 0000, 0000, 0000, 0000,
-  /*18 */ 0000, 0000, 0000, 0000, 0000, 0000, 0000, 0000,
-  /*20 */ 0000, 0665, 0622, 0000, 0000, 0000, 0502, 0636,
-  /*28 */ 0515, 0000, 0000, 0512, 0663, 0000, 0652, 0511,
-  /*30 */ 0537, 0536, 0534, 0530, 0520, 0500, 0501, 0503,
-  /*38 */ 0507, 0517, 0607, 0625, 0000, 0521, 0000, 0614,
-  /*40 */ 0000, 0202, 0401, 0405, 0301, 0100, 0404, 0303,
-  /*48 */ 0400, 0200, 0416, 0305, 0402, 0203, 0201, 0307,
-  /*50 */ 0406, 0413, 0302, 0300, 0101, 0304, 0410, 0306,
-  /*58 */ 0411, 0415, 0403, 0000, 0000, 0000, 0000, 0000,
-  /*60 */ 0000, 0202, 0401, 0405, 0301, 0100, 0404, 0303,
-  /*68 */ 0400, 0200, 0416, 0305, 0402, 0203, 0201, 0307,
-  /*70 */ 0406, 0413, 0302, 0300, 0101, 0304, 0410, 0306,
-  /*78 */ 0411, 0415, 0403, 0000, 0000, 0000, 0000, 0000
-};
+// Encoded text is a run-length stream, one byte per key-down or key-up run.
+// The top bit is set for key-down and the low bits hold the length in dot
+// units, so "A" is up 1, down 1, up 1, down 3, up 1 before the next letter.
+// The gap after a character and the one a space adds are MORSE_CHAR_GAP and
+// MORSE_WORD_GAP units, stretched for Farnsworth spacing.
+#define MORSE_RUN_KEY 0x80
+#define MORSE_RUN_UNITS 0x7f
+#define MORSE_RUN_IS_KEY(r) (((r) & MORSE_RUN_KEY) != 0)
+#define MORSE_RUN_LENGTH(r) ((r) & MORSE_RUN_UNITS)
+#define MORSE_CHAR_GAP 1
+#define MORSE_WORD_GAP 2
+
+// Runs kept encoded ahead of playback, and the most one character adds
+// (the longest code with its gaps, the trailing gap and the final gap)
+#define MORSE_CODE_WINDOW 4096
+#define MORSE_CHAR_RUNS_MAX (2 * MORSE_SYMBOL_MAX + 2)
+
+// Bytes of text between two seek checkpoints, at least
+#define MORSE_INDEX_STRIDE 64
+
+// Text buffers the sink pad may queue before its chain function blocks
+#define MORSE_STREAM_QUEUE_SIZE 4
+
+// Byte offset of a checkpoint character, and the dot units and key-down
+// samples before it
+typedef struct {
+  gsize offset;
+  guint64 units;
+  guint64 keyed;
+} MorseCheckpoint;
+
+// The dot grid keyed runs are counted on, as gst_morse_src_run_samples
+// does: whole dots of `dot` samples, or with `exact` (high speed) ending on
+// the grid of num / den samples per unit from unit 0
+typedef struct {
+  guint64 num;
+  guint64 den;
+  guint dot;
+  gboolean exact;
+} MorseGrid;
+
+// A checkpoint at the first character boundary every MORSE_INDEX_STRIDE
+// bytes of a closed text. A seek
+// binary searches it and only re-encodes from the checkpoint on. The
+// key-down samples of the checkpoints are counted for `grid` and again
+// when a seek comes with another one (den 0 until the first).
+typedef struct {
+  guint64 units;
+  MorseGrid grid;
+  guint n_points;
+  MorseCheckpoint points[];
+} MorseIndex;
+
+// The text is encoded a window at a time as playback advances, so memory
+// and start-up cost do not grow with the text. `text` is borrowed and
+// must outlive the code, `table` is referenced. An open code is fed more text as it arrives and
+// only gets its closing gap once closed.
+typedef struct {
+  const gchar *text;
+  const gchar *cursor;
+  const gchar *end;
+  gboolean open;
+  gboolean done;
+  gboolean indexable;
+  MorseIndex *index;
+  guint8 *runs;
+  guint n_runs;
+  guint capacity;
+  guint64 units;
+  guint64 played;
+  guint8 last;
+  guint char_gap;
+  guint word_gap;
+  MorseTable *table;
+} MorseCode;
+
+// Tone engines used to render the sine carrier
+typedef enum {
+  GST_MORSE_OSCILLATOR_SIN,
+  GST_MORSE_OSCILLATOR_WAVETABLE,
+  GST_MORSE_OSCILLATOR_RECURSIVE
+} GstMorseOscillator;
+
+#define GST_TYPE_MORSE_OSCILLATOR (gst_morse_oscillator_get_type ())
+static GType
+gst_morse_oscillator_get_type (void)
+{
+  static GType morse_oscillator_type = 0;
+  static const GEnumValue oscillators[] = {
+    {GST_MORSE_OSCILLATOR_SIN, "Call sin() for every sample", "sin"},
+    {GST_MORSE_OSCILLATOR_WAVETABLE, "Interpolated wavetable lookup", "wavetable"},
+    {GST_MORSE_OSCILLATOR_RECURSIVE, "Rotating phasor recurrence", "recursive"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_oscillator_type) {
+    morse_oscillator_type =
+        g_enum_register_static ("GstMorseOscillator", oscillators);
+  }
+  return morse_oscillator_type;
+}
+
+#define GST_TYPE_MORSE_SIMD (gst_morse_simd_get_type ())
+static GType
+gst_morse_simd_get_type (void)
+{
+  static GType morse_simd_type = 0;
+  static const GEnumValue simds[] = {
+    {GST_MORSE_SIMD_AUTO, "Best kernels the CPU supports", "auto"},
+    {GST_MORSE_SIMD_NONE, "Scalar generators only", "none"},
+    {GST_MORSE_SIMD_SSE2, "SSE2 kernels", "sse2"},
+    {GST_MORSE_SIMD_AVX2, "AVX2 kernels", "avx2"},
+    {GST_MORSE_SIMD_NEON, "NEON kernels", "neon"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_simd_type) {
+    morse_simd_type = g_enum_register_static ("GstMorseSimd", simds);
+  }
+  return morse_simd_type;
+}
+
+// Shape of the rise and fall of every keyed element
+typedef enum {
+  GST_MORSE_ENVELOPE_LINEAR,
+  GST_MORSE_ENVELOPE_RAISED_COSINE,
+  GST_MORSE_ENVELOPE_BLACKMAN
+} GstMorseEnvelope;
+
+#define GST_TYPE_MORSE_ENVELOPE (gst_morse_envelope_get_type ())
+static GType
+gst_morse_envelope_get_type (void)
+{
+  static GType morse_envelope_type = 0;
+  static const GEnumValue envelopes[] = {
+    {GST_MORSE_ENVELOPE_LINEAR, "Linear ramp", "linear"},
+    {GST_MORSE_ENVELOPE_RAISED_COSINE, "Raised cosine ramp", "raised-cosine"},
+    {GST_MORSE_ENVELOPE_BLACKMAN, "Blackman window ramp", "blackman"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_envelope_type) {
+    morse_envelope_type =
+        g_enum_register_static ("GstMorseEnvelope", envelopes);
+  }
+  return morse_envelope_type;
+}
+
+#define GST_TYPE_MORSE_FADING (gst_morse_fading_get_type ())
+static GType
+gst_morse_fading_get_type (void)
+{
+  static GType morse_fading_type = 0;
+  static const GEnumValue fadings[] = {
+    {GST_MORSE_FADING_NONE, "No fading", "none"},
+    {GST_MORSE_FADING_RAYLEIGH, "Rayleigh, one faded path", "rayleigh"},
+    {GST_MORSE_FADING_WATTERSON, "Watterson, two faded paths", "watterson"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_fading_type) {
+    morse_fading_type = g_enum_register_static ("GstMorseFading", fadings);
+  }
+  return morse_fading_type;
+}
+
+// How a queued message takes over from the one playing
+typedef enum {
+  GST_MORSE_QUEUE_MODE_REPLACE,
+  GST_MORSE_QUEUE_MODE_APPEND
+} GstMorseQueueMode;
+
+#define GST_TYPE_MORSE_QUEUE_MODE (gst_morse_queue_mode_get_type ())
+static GType
+gst_morse_queue_mode_get_type (void)
+{
+  static GType morse_queue_mode_type = 0;
+  static const GEnumValue queue_modes[] = {
+    {GST_MORSE_QUEUE_MODE_REPLACE, "Newest message interrupts at the next element", "replace"},
+    {GST_MORSE_QUEUE_MODE_APPEND, "Messages play back to back", "append"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_queue_mode_type) {
+    morse_queue_mode_type =
+        g_enum_register_static ("GstMorseQueueMode", queue_modes);
+  }
+  return morse_queue_mode_type;
+}
+
+// What a one-shot element does once its message is played
+typedef enum {
+  GST_MORSE_ONE_SHOT_MODE_READY,
+  GST_MORSE_ONE_SHOT_MODE_EOS,
+  GST_MORSE_ONE_SHOT_MODE_WAIT
+} GstMorseOneShotMode;
+
+#define GST_TYPE_MORSE_ONE_SHOT_MODE (gst_morse_one_shot_mode_get_type ())
+static GType
+gst_morse_one_shot_mode_get_type (void)
+{
+  static GType morse_one_shot_mode_type = 0;
+  static const GEnumValue one_shot_modes[] = {
+    {GST_MORSE_ONE_SHOT_MODE_READY, "Go back to READY", "ready"},
+    {GST_MORSE_ONE_SHOT_MODE_EOS, "Send EOS", "eos"},
+    {GST_MORSE_ONE_SHOT_MODE_WAIT, "Wait for the next text without changing state", "wait"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_one_shot_mode_type) {
+    morse_one_shot_mode_type =
+        g_enum_register_static ("GstMorseOneShotMode", one_shot_modes);
+  }
+  return morse_one_shot_mode_type;
+}
+
+// How silent stretches between the keyed elements are sent
+typedef enum {
+  GST_MORSE_GAP_MODE_NONE,
+  GST_MORSE_GAP_MODE_FLAG,
+  GST_MORSE_GAP_MODE_EVENT
+} GstMorseGapMode;
+
+#define GST_TYPE_MORSE_GAP_MODE (gst_morse_gap_mode_get_type ())
+static GType
+gst_morse_gap_mode_get_type (void)
+{
+  static GType morse_gap_mode_type = 0;
+  static const GEnumValue gap_modes[] = {
+    {GST_MORSE_GAP_MODE_NONE, "Silence is rendered like any other audio", "none"},
+    {GST_MORSE_GAP_MODE_FLAG, "Silence is sent as GAP flagged buffers", "flag"},
+    {GST_MORSE_GAP_MODE_EVENT, "Silence is sent as GAP events", "event"},
+    {0, NULL, NULL},
+  };
+
+  if (!morse_gap_mode_type) {
+    morse_gap_mode_type =
+        g_enum_register_static ("GstMorseGapMode", gap_modes);
+  }
+  return morse_gap_mode_type;
+}
+
+// A message encoded by the thread that queued it
+typedef struct {
+  gchar *text;
+  MorseCode *morse;
+  GstClockTime set_time;
+} MorseMessage;
+
+// One message of the "voices" property, keyed at its own speed and tone
+// and mixed with the others. Unset frequency/wpm/volume (zero or negative)
+// follow the element when the voice is prepared, `gains` holds a factor
+// per output channel.
+typedef struct {
+  gchar *text;
+  gdouble frequency;
+  gdouble volume;
+  gint wpm;
+  gdouble pan;
+  gboolean panned;
+  gint channel;
+  gboolean repeat;
+  MorseTable *table;
+
+  MorseCode *code;
+  guint position;
+  guint symbol_offset;
+  guint64 text_samples;
+  guint64 dot_num;
+  guint64 dot_den;
+  guint samples_per_dot;
+  gdouble phase;
+  gdouble phase_increment;
+  gdouble gain;
+  gdouble *gains;
+  gint rate;
+  gint channels;
+  gboolean finished;
+} MorseVoice;
+
+// Hot path counters behind the "stats" property. Writers only ever add or
+// store with relaxed atomics and get_property loads each value whole, so
+// the counters cost no lock and can stay on in production.
+typedef struct {
+  guint64 buffers;
+  guint64 samples;
+  guint64 generate_time;
+  guint64 pack_time;
+  guint64 allocations;
+  guint64 texts_applied;
+  guint64 texts_dropped;
+  guint64 lock_waits;
+  guint64 text_latency;
+} MorseStats;
+
+#define MORSE_STAT_ADD(src, field, n) \
+  __atomic_fetch_add (&(src)->stats.field, (guint64) (n), __ATOMIC_RELAXED)
+#define MORSE_STAT_SET(src, field, v) \
+  __atomic_store_n (&(src)->stats.field, (guint64) (v), __ATOMIC_RELAXED)
+#define MORSE_STAT_GET(src, field) \
+  __atomic_load_n (&(src)->stats.field, __ATOMIC_RELAXED)
+
+// What rendered audio depends on besides the text and the caps
+typedef struct {
+  gdouble frequency;
+  gdouble volume;
+  gint wpm;
+  gboolean high_speed;
+  GstMorseOscillator oscillator;
+  gboolean symbol_cache;
+  GstClockTime rise_time;
+  GstMorseEnvelope envelope;
+} MorseRenderParams;
+
+// One message in the process-wide render cache, `size` bytes of raw audio
+// in `memory` or of encoded packets in `packets`, `samples` long
+typedef struct {
+  gchar *key;
+  gsize size;
+  GstMemory *memory;
+  GstBufferList *packets;
+  GstCaps *caps;
+  guint64 samples;
+} MorseSharedEntry;
 
 // Forward type declarations
 typedef struct _GstMorseSrc GstMorseSrc;
 typedef struct _GstMorseSrcClass GstMorseSrcClass;
 
-// Define the function pointer type for generating morse code
-typedef void (*CW_GENERATE_FUNC) (GstMorseSrc*, guint8 *, gint);
+// Define the function pointer type for generating morse code. It renders
+// `count` samples starting at sample `first` of an element `samples` long,
+// so an element can be split across buffers.
+typedef void (*CW_GENERATE_FUNC) (GstMorseSrc*, guint8 *, gint, gint, gint);
+
+// Convert `n` interleaved mix samples to the output sample type
+typedef void (*MORSE_MIX_FUNC) (guint8 *, const gdouble *, gint);
 
 // Define the class structure for the morse source
 struct _GstMorseSrcClass
 {
   GstPushSrcClass parent_class;
+
+  // Action signals
+  gboolean (*push_text) (GstMorseSrc *src, const gchar *text);
 };
 
 // Define the structure for the morse source
@@ -149,25 +576,236 @@ struct _GstMorseSrc
   gdouble volume;
   gint wpm;
   gboolean one_shot;
+  GstMorseOneShotMode one_shot_mode;
+  // The next text was waited for after a one-shot message, its timeline
+  // carries on from the current running time
+  gboolean rearmed;
   CW_GENERATE_FUNC cwfunc;
   GstAudioFormatPack packfunc;
   guint packsize;
+  // The message playing, which generated_morse borrows, and the last one
+  // set through the property that get_property reports. Both under lock.
   gchar *text;
-  GString *generated_morse;
+  gchar *text_prop;
+  MorseCode *generated_morse;
   guint position;
   guint samples_per_dot;
   guint samples_per_dash;
   guint samples_per_space;
-  GstClockTime timestamp;
+  // Buffers are stamped from a running sample counter on top of a base
+  // time, so rounding never accumulates
+  GstClockTime time_base;
+  guint64 sample_offset;
+
+  // The exact dot length is dot_num / dot_den samples. Samples of the
+  // current text before the current run, and the unit/sample pair the dot
+  // grid was last rebased at after a speed change or seek.
+  guint64 dot_num;
+  guint64 dot_den;
+  gboolean timing_dirty;
+  guint64 text_samples;
+  guint64 unit_base;
+  guint64 sample_base;
   gdouble phase;
   gdouble phase_increment;
+
+  // Volume and frequency are synced from their control bindings once per
+  // buffer, at its start, and glide towards their value at its end a tone
+  // block at a time. `level` is the volume of the block being rendered.
+  gboolean controlled;
+  gdouble level;
+  gdouble control_volume;
+  gdouble volume_slope;
+  gdouble control_increment;
+  gdouble increment_slope;
+
+  // Channel simulation. Fading and drift are folded into the volume and
+  // frequency glides, noise is added to every rendered block, gaps
+  // included (`mute` renders a block of noise only).
+  gboolean noise;
+  gdouble snr;
+  GstMorseFading fading;
+  gdouble fading_rate;
+  gdouble chirp;
+  gdouble drift;
+  guint seed;
+  gboolean simulating;
+  gboolean mute;
+  gdouble noise_sigma;
+  MorseChannel channel;
+  guint64 channel_offset;
+  GstMorseOscillator oscillator;
+  GstMorseSimd simd;
+  const GstMorseKernels *kernels;
+
+  // High-speed lifts the WPM and dot length limits and puts keyed runs on
+  // the exact dot grid too. wpm_requested is kept so the order the two
+  // properties are set in does not matter.
+  gboolean high_speed;
+  gint wpm_requested;
+  gint farnsworth_wpm;
+  gdouble tone[MORSE_TONE_BLOCK];
+
+  // Code table new texts are encoded with, swapped under the object lock
+  // when "table-file" is set. Texts already encoded keep their own ref.
+  MorseTable *table;
+  gchar *table_file;
+
+  // Rise/fall tables by ramp length, built by the streaming thread for the
+  // current timing and again at the next buffer after rise-time or
+  // envelope changed
+  GstClockTime rise_time;
+  GstMorseEnvelope envelope;
+  gboolean envelope_dirty;
+  struct {
+    gint fade;
+    gdouble *table;
+  } envelopes[MORSE_ENVELOPE_SLOTS];
+  guint envelope_next;
+
+  // Pre-rendered symbols in the negotiated output format
+  gboolean symbol_cache;
+  gboolean cache_dirty;
+  guint8 *cache;
+  guint8 *cache_dot;
+  guint8 *cache_dash;
+
+  // Output buffer sizing and the unpacked intermediate for packfunc formats.
+  // The effective block size lives in the GstBaseSrc blocksize, which
+  // setcaps derives from samples-per-buffer/buffer-time unless the
+  // application set blocksize itself.
+  guint samples_per_buffer;
+  guint64 buffer_time;
+  gboolean user_blocksize;
+  guint block_samples;
+  guint8 *scratch;
+  guint scratch_samples;
+
+  // Samples of the current element already emitted in earlier buffers
+  guint symbol_offset;
+
+  // Live mode, buffers are timestamped in running time of the pipeline clock
+  gboolean is_live;
+  guint64 latency_time;
+  gboolean live_started;
+
+  // Running time a text was set at, how long it took to become audible
+  // is kept in stats.text_latency
+  GstClockTime text_set_time;
+
+  // Silent stretches in gap mode are slices of one block of silence,
+  // filled once per caps, and carry GST_BUFFER_FLAG_GAP
+  GstMorseGapMode gap_mode;
+  GstMemory *silence;
+
+  // Key state changes posted as "morse-keying" messages, without audio
+  // every buffer is silence and only the keying is of use
+  gboolean keying_messages;
+  gboolean render_audio;
+  gboolean keyed;
+
+  // Multi producer/single consumer ring of encoded messages. Producers
+  // claim a slot by moving queue_tail with a compare-and-swap, then publish
+  // it through its sequence number, the streaming thread only writes
+  // queue_head. A slot holds a message once queue_seq is its index + 1
+  // and is free for index + MORSE_TEXT_QUEUE_SIZE. `text_waiting` is set
+  // while a one-shot element waits for a message under stream_lock, only
+  // then do producers take the lock to wake it.
+  GstMorseQueueMode queue_mode;
+  // Queued messages start on the sample after the last one, in the same
+  // buffer and timeline. `chained` is set for such a message, it is
+  // rendered rather than taken from the shared cache to keep the phase.
+  gboolean gapless;
+  gboolean chained;
+  MorseMessage *queue[MORSE_TEXT_QUEUE_SIZE];
+  gint queue_seq[MORSE_TEXT_QUEUE_SIZE];
+  gint queue_head;
+  gint queue_tail;
+  gint text_waiting;
+
+  // Text arriving on the "sink" request pad. The chain function blocks
+  // while MORSE_STREAM_QUEUE_SIZE buffers wait, the buffer being encoded
+  // stays mapped so the encoder reads it in place. The sink side only
+  // refuses buffers for its own flush or once stopped, `streaming`
+  // follows the src side unlocks. A UTF-8 character cut at the end of a
+  // buffer waits in stream_carry and is joined to the start of the next
+  // one in stream_joined.
+  GstPad *stream_pad;
+  GMutex stream_lock;
+  GCond stream_cond;
+  GQueue stream_queue;
+  gboolean stream_eos;
+  gboolean stream_flushing;
+  gboolean stream_stopped;
+  gboolean streaming;
+  GstBuffer *stream_buffer;
+  GstMapInfo stream_map;
+  gchar stream_carry[3];
+  gsize stream_carry_len;
+  gchar *stream_joined;
+
+  // Rendering on the shared worker pool, see "render-pool". `pooled` is
+  // fixed at start. A job renders one buffer into pool_queue, at most
+  // render_ahead wait there for create(). Guarded by stream_lock, except
+  // pool_segment which only the job rendering touches.
+  gboolean render_pool;
+  guint render_ahead;
+  gboolean pooled;
+  GQueue pool_queue;
+  gboolean pool_scheduled;
+  gboolean pool_flushing;
+  gboolean pool_done;
+  GstEvent *pool_segment;
+
+  // Encoded output, see gst_morse_src_produce_encoded. The open encoder
+  // session started at encoded_base, encoded_pending holds its packets in
+  // stream time. A FLAC message found in the shared cache replays
+  // encoded_replay from encoded_start, a missed one is recorded into
+  // encoded_recording under encoded_key.
+  MorseEncoder *encoder;
+  const gchar *encoded_format;
+  GstCaps *encoded_caps;
+  GstClockTime encoded_base;
+  GQueue encoded_pending;
+  GstFlowReturn encoded_flow;
+  GstBufferList *encoded_replay;
+  guint encoded_index;
+  GstClockTime encoded_start;
+  guint64 encoded_samples;
+  GstBufferList *encoded_recording;
+  guint64 encoded_recorded;
+  gchar *encoded_key;
+  MorseRenderParams encoded_params;
+
+  // Independent messages mixed into each buffer, see "voices". The
+  // streaming thread owns `voices`, a new set waits in pending_voices.
+  // voices_channels is the channel count the set asks for at fixation.
+  gchar *voices_desc;
+  GPtrArray *voices;
+  GPtrArray *pending_voices;
+  gboolean voices_changed;
+  guint voices_channels;
+  MORSE_MIX_FUNC mixfunc;
+  gdouble *mix;
+  guint mix_samples;
+
+  // Whole messages shared with other elements through the process-wide
+  // render cache. A hit pushes sub-buffers of shared_memory while the runs
+  // are walked as usual, a miss records the output for the next element.
+  gboolean shared_cache;
+  GstMemory *shared_memory;
+  GByteArray *shared_recording;
+  gchar *shared_key;
+  MorseRenderParams shared_params;
+
+  MorseStats stats;
+
   GstSegment segment;
   GstAudioInfo info;
   
   // Thread safety and state management
   GMutex lock;
-  gboolean new_text_pending;
-  gchar *pending_text;
+  GstClockTime about_to_finish_time;
   gboolean about_to_finish_posted;
   gboolean playback_complete;
   GstState state;
@@ -186,12 +824,58 @@ enum {
   PROP_WPM,
   PROP_TEXT,
   PROP_ONE_SHOT,
+  PROP_ONE_SHOT_MODE,
+  PROP_ABOUT_TO_FINISH_TIME,
+  PROP_GAPLESS,
+  PROP_OSCILLATOR,
+  PROP_SIMD,
+  PROP_SYMBOL_CACHE,
+  PROP_HIGH_SPEED,
+  PROP_FARNSWORTH_WPM,
+  PROP_TABLE_FILE,
+  PROP_RISE_TIME,
+  PROP_ENVELOPE,
+  PROP_NOISE,
+  PROP_SNR,
+  PROP_FADING,
+  PROP_FADING_RATE,
+  PROP_CHIRP,
+  PROP_DRIFT,
+  PROP_SEED,
+  PROP_SAMPLES_PER_BUFFER,
+  PROP_BUFFER_TIME,
+  PROP_IS_LIVE,
+  PROP_LATENCY_TIME,
+  PROP_QUEUE_MODE,
+  PROP_GAP_MODE,
+  PROP_KEYING_MESSAGES,
+  PROP_RENDER_AUDIO,
+  PROP_VOICES,
+  PROP_SHARED_CACHE,
+  PROP_SHARED_CACHE_SIZE,
+  PROP_RENDER_POOL,
+  PROP_RENDER_AHEAD,
+  PROP_ALLOCATIONS,
+  PROP_STATS,
   LAST_PROP
 };
 
+// Define the signals
+enum {
+  SIGNAL_PUSH_TEXT,
+  LAST_SIGNAL
+};
+
+static guint gst_morse_src_signals[LAST_SIGNAL] = { 0 };
+
 // Function declarations
-static void morse_send_char (GString *text, int ch);
-static void morse_send_string (GString *text, const char *str);
+static MorseCode *morse_code_new (MorseTable *table, const gchar *str,
+    gsize len, gboolean open, guint char_gap, guint word_gap);
+static void morse_code_free (MorseCode *code);
+static void morse_code_advance (MorseCode *code, guint *position);
+static GstFlowReturn gst_morse_src_produce (GstMorseSrc *src,
+    GstBuffer **buffer);
+static void gst_morse_src_encoded_reset (GstMorseSrc *src);
 static GstCaps *gst_morse_src_fixate (GstBaseSrc * bsrc, GstCaps * caps);
 static gboolean gst_morse_src_setcaps (GstBaseSrc * basesrc, GstCaps * caps);
 static void gst_morse_src_class_init (GstMorseSrcClass * klass);
@@ -201,6 +885,19 @@ static GType gst_morse_src_get_type (void);
 // Type registration
 G_DEFINE_TYPE (GstMorseSrc, gst_morse_src, GST_TYPE_PUSH_SRC)
 
+// Marks buffers this element has already counted as allocated
+static GQuark morse_buffer_quark;
+
+// Take src->lock, counting the times another thread was holding it
+static inline void
+gst_morse_src_lock (GstMorseSrc *src)
+{
+  if (!g_mutex_trylock (&src->lock)) {
+    MORSE_STAT_ADD (src, lock_waits, 1);
+    g_mutex_lock (&src->lock);
+  }
+}
+
 // Define the pad template for the morse source
 static GstStaticPadTemplate src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
@@ -210,17 +907,35 @@ GST_STATIC_PAD_TEMPLATE ("src",
                                        "format = (string) " FORMAT_STR ", "
                                        "rate = " GST_AUDIO_RATE_RANGE ", "
                                        "layout = interleaved,"
-                                       "channels = " GST_AUDIO_CHANNELS_RANGE)
+                                       "channels = " GST_AUDIO_CHANNELS_RANGE "; "
+                                       "audio/x-opus, "
+                                       "rate = (int) { 48000, 24000, 16000, 12000, 8000 }, "
+                                       "channels = (int) [ 1, 2 ], "
+                                       "channel-mapping-family = (int) 0; "
+                                       "audio/x-flac, "
+                                       "framed = (boolean) true, "
+                                       "rate = (int) [ 1, 655350 ], "
+                                       "channels = (int) [ 1, 8 ]")
                         );
 
+// Optional text input, see gst_morse_src_request_new_pad
+static GstStaticPadTemplate sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+                        GST_PAD_SINK,
+                        GST_PAD_REQUEST,
+                        GST_STATIC_CAPS ("text/x-raw, format = (string) utf8")
+                        );
+
+// `remaining` is the time left of the message after the last buffer
 static void
-gst_morse_src_post_about_to_finish (GstMorseSrc *src)
+gst_morse_src_post_about_to_finish (GstMorseSrc *src, GstClockTime remaining)
 {
   GstMessage *message;
   
   message = gst_message_new_application (GST_OBJECT (src),
       gst_structure_new ("about-to-finish",
           "source", G_TYPE_STRING, "morsesrc",
+          "remaining", G_TYPE_UINT64, remaining,
           NULL));
   
   gst_element_post_message (GST_ELEMENT (src), message);
@@ -239,468 +954,3947 @@ gst_morse_src_post_playback_complete (GstMorseSrc *src)
   gst_element_post_message (GST_ELEMENT (src), message);
 }
 
-// Idle callback for state change
-static gboolean
-gst_morse_src_idle_state_change (gpointer user_data)
+// Runs on the element's async thread pool, the streaming thread cannot
+// change the state itself and no main loop is needed
+static void
+gst_morse_src_async_ready (GstElement *element, gpointer user_data)
 {
-  GstMorseSrc *src = GST_MORSE_SRC (user_data);
-  
-  gst_element_set_state (GST_ELEMENT (src), GST_STATE_READY);
-  g_object_unref (src);
-  
-  return G_SOURCE_REMOVE;
+  gst_element_set_state (element, GST_STATE_READY);
 }
 
 static void
-gst_morse_src_update_text (GstMorseSrc *src)
+morse_message_free (MorseMessage *msg)
 {
-  GstEvent *segment_event;
-  gboolean was_playing = FALSE;
+  g_free (msg->text);
+  morse_code_free (msg->morse);
+  g_free (msg);
+}
 
-  g_mutex_lock(&src->lock);
-  if (!src->new_text_pending || !src->pending_text) {
-    g_mutex_unlock(&src->lock);
-    return;
+// Producer side of the ring, callable from any thread and never blocks.
+// Returns FALSE when it is full.
+static gboolean
+gst_morse_src_queue_push (GstMorseSrc *src, MorseMessage *msg)
+{
+  for (;;) {
+    gint tail = g_atomic_int_get (&src->queue_tail);
+    gint slot = tail & (MORSE_TEXT_QUEUE_SIZE - 1);
+    gint diff = g_atomic_int_get (&src->queue_seq[slot]) - tail;
+
+    // Still holding the message of the previous lap
+    if (diff < 0)
+      return FALSE;
+
+    // Another producer claimed it first otherwise, try the next one
+    if (diff == 0 && g_atomic_int_compare_and_exchange (&src->queue_tail,
+            tail, tail + 1)) {
+      src->queue[slot] = msg;
+      // Publishes the message before the consumer can see the slot
+      g_atomic_int_set (&src->queue_seq[slot], tail + 1);
+      return TRUE;
+    }
   }
+}
 
-  was_playing = (src->state == GST_STATE_PLAYING);
+// Whether no message is published at the head, for the streaming thread
+static gboolean
+gst_morse_src_queue_empty (GstMorseSrc *src)
+{
+  gint head = src->queue_head;
 
-  // Update the text
-  if (src->text)
-    g_free(src->text);
-  src->text = src->pending_text;
-  src->pending_text = NULL;
-  src->new_text_pending = FALSE;
+  return g_atomic_int_get (&src->queue_seq[head &
+          (MORSE_TEXT_QUEUE_SIZE - 1)]) != head + 1;
+}
 
-  if (src->generated_morse)
-    g_string_free(src->generated_morse, TRUE);
+// Consumer side of the ring, only called by the streaming thread
+static MorseMessage *
+gst_morse_src_queue_pop (GstMorseSrc *src)
+{
+  gint head = src->queue_head;
+  gint slot = head & (MORSE_TEXT_QUEUE_SIZE - 1);
+  MorseMessage *msg;
 
-  src->generated_morse = g_string_new(NULL);
-  morse_send_string(src->generated_morse, src->text);
-  src->position = 0;
-  src->about_to_finish_posted = FALSE;
-  src->playback_complete = FALSE;
-  src->timestamp = 0;
+  if (gst_morse_src_queue_empty (src))
+    return NULL;
 
-  // Reset segment
-  gst_segment_init(&src->segment, GST_FORMAT_TIME);
+  msg = src->queue[slot];
+  // Frees the slot for the producers of the next lap
+  g_atomic_int_set (&src->queue_seq[slot], head + MORSE_TEXT_QUEUE_SIZE);
+  g_atomic_int_set (&src->queue_head, head + 1);
+  return msg;
+}
 
-  if (was_playing) {
-    // Send new segment
-    segment_event = gst_event_new_segment(&src->segment);
-    gst_pad_push_event(GST_BASE_SRC_PAD(src), segment_event);
-  }
+// Whether a queued message should start at the current element boundary
+static gboolean
+gst_morse_src_text_ready (GstMorseSrc *src)
+{
+  if (src->symbol_offset != 0 || src->stream_pad ||
+      gst_morse_src_queue_empty (src))
+    return FALSE;
 
-  g_mutex_unlock(&src->lock);
+  if (src->queue_mode == GST_MORSE_QUEUE_MODE_APPEND)
+    return !src->generated_morse ||
+        src->position >= src->generated_morse->n_runs;
 
-  // Notify the pipeline of format changes
-  gst_element_post_message(GST_ELEMENT(src),
-      gst_message_new_duration_changed(GST_OBJECT(src)));
+  return TRUE;
 }
 
-static GstStateChangeReturn
-gst_morse_src_change_state (GstElement * element, GstStateChange transition)
+// Gap after each character and per space for new texts. Farnsworth keeps
+// the characters at "wpm" and stretches the spacing so that the text as a
+// whole goes at "farnsworth-wpm": spacing units of (50 c / s - 31) / 19
+// dots for c WPM characters at s WPM overall, rounded to whole dots.
+static void
+gst_morse_src_spacing (GstMorseSrc *src, guint *char_gap, guint *word_gap)
 {
-  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
-  GstMorseSrc *src = GST_MORSE_SRC (element);
-
-  switch (transition) {
-    case GST_STATE_CHANGE_NULL_TO_READY:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_READY;
-      src->playback_complete = FALSE;
-      g_mutex_unlock(&src->lock);
-      break;
-    case GST_STATE_CHANGE_READY_TO_PAUSED:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_PAUSED;
-      g_mutex_unlock(&src->lock);
-      break;
-    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_PLAYING;
-      g_mutex_unlock(&src->lock);
-      break;
-    default:
-      break;
-  }
+  gint wpm = src->wpm;
+  gint farnsworth = src->farnsworth_wpm;
+  gdouble stretch;
+  guint letter, word;
 
-  ret = GST_ELEMENT_CLASS (gst_morse_src_parent_class)->change_state (element, transition);
-  if (ret == GST_STATE_CHANGE_FAILURE)
-    return ret;
+  *char_gap = MORSE_CHAR_GAP;
+  *word_gap = MORSE_WORD_GAP;
+  if (farnsworth <= 0 || farnsworth >= wpm)
+    return;
 
-  switch (transition) {
-    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_PAUSED;
-      g_mutex_unlock(&src->lock);
-      break;
-    case GST_STATE_CHANGE_PAUSED_TO_READY:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_READY;
-      g_mutex_unlock(&src->lock);
-      break;
-    case GST_STATE_CHANGE_READY_TO_NULL:
-      g_mutex_lock(&src->lock);
-      src->state = GST_STATE_NULL;
-      g_mutex_unlock(&src->lock);
-      break;
-    default:
-      break;
-  }
+  // A letter gap is the gap after a character plus the one before the
+  // next symbol, a word gap adds the space. Both stay within one run.
+  stretch = (50.0 * wpm / farnsworth - 31.0) / 19.0;
+  letter = CLAMP ((guint) lround ((MORSE_CHAR_GAP + 1) * stretch),
+      MORSE_CHAR_GAP + 1, MORSE_RUN_UNITS / 2);
+  word = CLAMP ((guint) lround ((MORSE_CHAR_GAP + MORSE_WORD_GAP + 1) *
+          stretch), letter + MORSE_WORD_GAP, MORSE_RUN_UNITS);
 
-  return ret;
+  *char_gap = letter - 1;
+  *word_gap = word - letter;
 }
 
-static void
-morse_send_char (GString *text, int ch)
+// A ref to the current code table, callable from any thread
+static MorseTable *
+gst_morse_src_get_table (GstMorseSrc *src)
 {
-  int nsyms, bitreg;
+  MorseTable *table;
 
-  if (ch == ' ')
-    {
-      g_string_append (text, "  ");
-      return;
-    }
+  GST_OBJECT_LOCK (src);
+  table = morse_table_ref (src->table);
+  GST_OBJECT_UNLOCK (src);
 
-  bitreg = morse_table[ch & 0x7f];
+  return table;
+}
 
-  if ((nsyms = (bitreg >> 6) & 07) == 0)
-    nsyms = 8;
+static gboolean
+gst_morse_src_enqueue_text (GstMorseSrc *src, const gchar *text)
+{
+  MorseMessage *msg;
+  MorseTable *table;
+  guint char_gap, word_gap;
 
-  bitreg &= 077;
+  msg = g_new0 (MorseMessage, 1);
+  msg->text = g_strdup (text);
+  gst_morse_src_spacing (src, &char_gap, &word_gap);
+  table = gst_morse_src_get_table (src);
+  msg->morse = morse_code_new (table, msg->text, strlen (msg->text), FALSE,
+      char_gap, word_gap);
+  morse_table_unref (table);
+  msg->set_time = gst_element_get_current_running_time (GST_ELEMENT (src));
 
-  while (nsyms-- > 0)
-    {
-      g_string_append_c (text, ' ');
-      if (bitreg & 01)
-        {
-          g_string_append_c (text, '-');
-        }
-      else
-        {
-          g_string_append_c (text, '.');
-        }
-      bitreg >>= 1;
-    }
+  if (!gst_morse_src_queue_push (src, msg)) {
+    GST_WARNING_OBJECT (src, "text queue full, dropping \"%s\"", text);
+    MORSE_STAT_ADD (src, texts_dropped, 1);
+    morse_message_free (msg);
+    return FALSE;
+  }
+
+  // Wake a one-shot element waiting for its next message. It sets the
+  // flag before it checks the ring, so either it sees this message or
+  // this sees the flag.
+  if (g_atomic_int_get (&src->text_waiting)) {
+    g_mutex_lock (&src->stream_lock);
+    g_cond_broadcast (&src->stream_cond);
+    g_mutex_unlock (&src->stream_lock);
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_morse_src_push_text (GstMorseSrc *src, const gchar *text)
+{
+  if (!text || strlen (text) == 0) {
+    GST_WARNING_OBJECT (src, "Empty text provided, ignoring");
+    return FALSE;
+  }
 
-  g_string_append_c (text, ' ');
+  return gst_morse_src_enqueue_text (src, text);
 }
 
+// Rendered messages shared by every morsesrc in the process, keyed on text,
+// parameters and caps. The table maps keys to links of the LRU queue, most
+// recently used at the head. Elements playing an entry hold their own
+// reference to its memory, eviction only drops the cache's one.
+static GMutex morse_shared_lock;
+static GHashTable *morse_shared_table;
+static GQueue morse_shared_lru = G_QUEUE_INIT;
+static guint64 morse_shared_bytes;
+static guint64 morse_shared_budget = DEFAULT_SHARED_CACHE_SIZE;
+
+// Drop least recently used entries until the cache fits its budget. Called
+// with morse_shared_lock held.
 static void
-morse_send_string (GString *text, const char *str)
+morse_shared_evict (void)
 {
-  while (*str)
-    {
-      morse_send_char (text, toupper (*str));
-      str++;
-    }
+  while (morse_shared_bytes > morse_shared_budget && morse_shared_lru.tail) {
+    GList *link = morse_shared_lru.tail;
+    MorseSharedEntry *entry = link->data;
 
-  g_string_append (text, "   ");
+    g_queue_unlink (&morse_shared_lru, link);
+    g_list_free_1 (link);
+    g_hash_table_remove (morse_shared_table, entry->key);
+    morse_shared_bytes -= entry->size;
+    if (entry->memory)
+      gst_memory_unref (entry->memory);
+    if (entry->packets)
+      gst_buffer_list_unref (entry->packets);
+    if (entry->caps)
+      gst_caps_unref (entry->caps);
+    g_free (entry->key);
+    g_free (entry);
+  }
 }
 
-// Define the macro for generating morse code with envelope shaping (20ms fade)
-#define CW_GENERATOR(sample_t, scale)                                  \
-static void                                                            \
-MORSE_CW_GENERATE_##sample_t (GstMorseSrc *src,                        \
-                             guint8 *buf, gint samples)                \
-{                                                                      \
-  sample_t *data = (sample_t *) buf;                                   \
-  /* Calculate 20ms fade in samples based on sample rate */           \
-  gint fade_samples = (gint)(0.020 * GST_AUDIO_INFO_RATE(&src->info)); \
-  /* Ensure fade doesn't exceed half the element duration */          \
-  fade_samples = MIN(fade_samples, samples / 2);                       \
-                                                                       \
-  for (gint i = 0; i < samples; i++) {                                 \
-    gdouble sample;                                                    \
-    gdouble envelope = 1.0;                                            \
-                                                                       \
-    /* Apply 20ms fade in/out to reduce clicks */                     \
-    if (i < fade_samples)                                              \
-      envelope = (gdouble)i / fade_samples;                            \
-    else if (i > samples - fade_samples)                              \
-      envelope = (gdouble)(samples - i) / fade_samples;                \
-                                                                       \
-    for (gint j = 0; j < GST_AUDIO_INFO_CHANNELS (&src->info); j++) {  \
-      sample = src->volume * scale * envelope * sin(src->phase);       \
-      data[i * GST_AUDIO_INFO_CHANNELS (&src->info) + j] = sample;     \
-    }                                                                  \
-    src->phase += src->phase_increment;                                \
-    if (src->phase >= 2.0 * G_PI)                                      \
-      src->phase -= 2.0 * G_PI;                                        \
-  }                                                                    \
+// Add a new entry as the most recently used. Called with morse_shared_lock
+// held.
+static void
+morse_shared_insert (MorseSharedEntry *entry)
+{
+  g_queue_push_head (&morse_shared_lru, entry);
+  g_hash_table_insert (morse_shared_table, entry->key, morse_shared_lru.head);
+  morse_shared_bytes += entry->size;
+  morse_shared_evict ();
 }
 
+// Look `key` up and make it the most recently used. Called with
+// morse_shared_lock held.
+static MorseSharedEntry *
+morse_shared_lookup (const gchar *key)
+{
+  GList *link = g_hash_table_lookup (morse_shared_table, key);
 
-// Generate morse code for different sample types
-CW_GENERATOR (gint16, 32767.0)
-CW_GENERATOR (gint32, 2147483647.0)
-CW_GENERATOR (gfloat, 1.0)
-CW_GENERATOR (gdouble, 1.0)
+  if (!link)
+    return NULL;
+
+  g_queue_unlink (&morse_shared_lru, link);
+  g_queue_push_head_link (&morse_shared_lru, link);
+  return link->data;
+}
 
 static void
-gst_morse_src_set_property (GObject *object, guint prop_id,
-                           const GValue *value, GParamSpec *pspec)
+gst_morse_src_render_params (GstMorseSrc *src, MorseRenderParams *params)
 {
-  GstMorseSrc *src = GST_MORSE_SRC (object);
+  params->frequency = src->frequency;
+  params->volume = src->volume;
+  params->wpm = src->wpm;
+  params->high_speed = src->high_speed;
+  params->oscillator = src->oscillator;
+  params->symbol_cache = src->symbol_cache;
+  params->rise_time = src->rise_time;
+  params->envelope = src->envelope;
+}
 
-  switch (prop_id)
-    {
-    case PROP_FREQUENCY:
-      {
-        gdouble freq = g_value_get_double (value);
-        if (freq < MIN_FREQUENCY || freq > MAX_FREQUENCY) {
-          GST_WARNING_OBJECT (src, "Frequency %f Hz out of range, clamping", freq);
-          freq = CLAMP(freq, MIN_FREQUENCY, MAX_FREQUENCY);
-        }
-        src->frequency = freq;
-        if (GST_AUDIO_INFO_RATE(&src->info) > 0) {
-          src->phase_increment = 2.0 * G_PI * src->frequency / GST_AUDIO_INFO_RATE(&src->info);
-        }
-      }
+// The parameters changed since `then`, when a message was looked up
+static gboolean
+gst_morse_src_params_changed (GstMorseSrc *src, const MorseRenderParams *then)
+{
+  MorseRenderParams now;
+
+  gst_morse_src_render_params (src, &now);
+  return now.frequency != then->frequency ||
+      now.volume != then->volume ||
+      now.wpm != then->wpm ||
+      now.high_speed != then->high_speed ||
+      now.oscillator != then->oscillator ||
+      now.symbol_cache != then->symbol_cache ||
+      now.rise_time != then->rise_time ||
+      now.envelope != then->envelope;
+}
+
+static gboolean
+gst_morse_src_shared_stale (GstMorseSrc *src)
+{
+  return gst_morse_src_params_changed (src, &src->shared_params);
+}
+
+// Cache key of the current message in the current caps and parameters
+static gchar *
+gst_morse_src_shared_key (GstMorseSrc *src)
+{
+  MorseCode *code = src->generated_morse;
+
+  return g_strdup_printf ("%s/%d/%d/%d/%d/%.6f/%.6f/%d/%d/%"
+      G_GUINT64_FORMAT "/%d/%u/%u/%s/%s",
+      gst_audio_format_to_string (GST_AUDIO_INFO_FORMAT (&src->info)),
+      GST_AUDIO_INFO_RATE (&src->info), GST_AUDIO_INFO_CHANNELS (&src->info),
+      src->wpm, src->high_speed, src->frequency, src->volume, src->oscillator,
+      src->symbol_cache, src->rise_time, src->envelope, code->char_gap,
+      code->word_gap, code->table->name, src->text);
+}
+
+// Stop playing from or recording into the shared cache
+static void
+gst_morse_src_shared_reset (GstMorseSrc *src)
+{
+  if (src->shared_memory) {
+    gst_memory_unref (src->shared_memory);
+    src->shared_memory = NULL;
+  }
+  if (src->shared_recording) {
+    g_byte_array_unref (src->shared_recording);
+    src->shared_recording = NULL;
+  }
+  g_free (src->shared_key);
+  src->shared_key = NULL;
+}
+
+// At the first sample of a message either take its audio from the shared
+// cache or start recording it for the elements that follow
+static void
+gst_morse_src_shared_begin (GstMorseSrc *src)
+{
+  MorseSharedEntry *entry;
+
+  gst_morse_src_render_params (src, &src->shared_params);
+  src->shared_key = gst_morse_src_shared_key (src);
+
+  g_mutex_lock (&morse_shared_lock);
+  if ((entry = morse_shared_lookup (src->shared_key)))
+    src->shared_memory = gst_memory_ref (entry->memory);
+  g_mutex_unlock (&morse_shared_lock);
+
+  if (src->shared_memory) {
+    GST_DEBUG_OBJECT (src, "playing \"%s\" from the shared cache", src->text);
+  } else {
+    // Recordings start keying at phase zero, as a seek expects
+    src->shared_recording = g_byte_array_new ();
+    src->phase = 0.0;
+  }
+}
+
+// The recorded message is complete, hand it to the cache unless it is
+// larger than the whole budget or another element stored it first
+static void
+gst_morse_src_shared_store (GstMorseSrc *src)
+{
+  gsize size = src->shared_recording->len;
+  guint8 *data = g_byte_array_free (src->shared_recording, FALSE);
+
+  src->shared_recording = NULL;
+
+  g_mutex_lock (&morse_shared_lock);
+  if (size > 0 && size <= morse_shared_budget &&
+      !g_hash_table_contains (morse_shared_table, src->shared_key)) {
+    MorseSharedEntry *entry = g_new0 (MorseSharedEntry, 1);
+
+    entry->key = src->shared_key;
+    entry->size = size;
+    entry->memory = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, data,
+        size, 0, size, data, g_free);
+    src->shared_key = NULL;
+    data = NULL;
+
+    morse_shared_insert (entry);
+    GST_DEBUG_OBJECT (src, "stored %" G_GSIZE_FORMAT " bytes, cache holds %"
+        G_GUINT64_FORMAT, size, morse_shared_bytes);
+  }
+  g_mutex_unlock (&morse_shared_lock);
+
+  g_free (data);
+}
+
+// FLAC frames stand alone, so a message can be encoded in a session of its
+// own and replayed anywhere. An Opus session carries encoder lookahead the
+// decoder skips once per stream and pads its last frame, so Opus output is
+// one session with a single timeline from start to EOS, and its packets
+// depend on what came before them. Opus is not replayed: every message is
+// encoded each time it plays.
+static gboolean
+gst_morse_src_encoded_per_message (GstMorseSrc *src)
+{
+  return src->encoder && g_strcmp0 (src->encoded_format, "flacenc") == 0;
+}
+
+// Start the next queued message. In replace mode everything queued behind
+// the newest message is dropped. Returns TRUE when it is chained to the
+// last message, on the next sample of the same timeline.
+static gboolean
+gst_morse_src_update_text (GstMorseSrc *src)
+{
+  GstEvent *segment_event;
+  MorseMessage *msg = NULL, *next;
+  gboolean was_playing = FALSE;
+  gboolean chained = (src->gapless || (src->encoder &&
+          !gst_morse_src_encoded_per_message (src))) &&
+      src->generated_morse != NULL;
+  gchar *old_text;
+
+  while ((next = gst_morse_src_queue_pop (src))) {
+    if (msg) {
+      MORSE_STAT_ADD (src, texts_dropped, 1);
+      morse_message_free (msg);
+    }
+    msg = next;
+    if (src->queue_mode == GST_MORSE_QUEUE_MODE_APPEND)
       break;
-    case PROP_VOLUME:
-      {
-        gdouble vol = g_value_get_double (value);
-        if (vol < MIN_VOLUME || vol > MAX_VOLUME) {
-          GST_WARNING_OBJECT (src, "Volume %f out of range, clamping", vol);
-          vol = CLAMP(vol, MIN_VOLUME, MAX_VOLUME);
-        }
-        src->volume = vol;
+  }
+
+  if (!msg)
+    return FALSE;
+
+  MORSE_STAT_ADD (src, texts_applied, 1);
+  src->position = 0;
+  src->symbol_offset = 0;
+  src->about_to_finish_posted = FALSE;
+  src->playback_complete = FALSE;
+  src->text_set_time = msg->set_time;
+  gst_morse_src_shared_reset (src);
+
+  // Only the swap needs the lock, get_property and queries read them
+  gst_morse_src_lock (src);
+  was_playing = (src->state == GST_STATE_PLAYING);
+  if (src->generated_morse)
+    morse_code_free (src->generated_morse);
+  src->generated_morse = msg->morse;
+  old_text = src->text;
+  src->text = msg->text;
+  g_mutex_unlock(&src->lock);
+
+  g_free (old_text);
+  g_free (msg);
+
+  // A live stream keeps running on the clock, only a non-live one restarts
+  // its timeline for the new message
+  src->text_samples = 0;
+  src->unit_base = 0;
+  src->sample_base = 0;
+
+  if (src->rearmed) {
+    // Right after the last message when it is still being played out,
+    // otherwise from now
+    GstClockTime end = src->time_base + gst_util_uint64_scale_int (
+        src->sample_offset, GST_SECOND, GST_AUDIO_INFO_RATE (&src->info));
+    GstClockTime now =
+        gst_element_get_current_running_time (GST_ELEMENT (src));
+
+    if (GST_CLOCK_TIME_IS_VALID (now) && now > end)
+      end = now;
+    src->time_base = end;
+    src->sample_offset = 0;
+    src->rearmed = FALSE;
+  } else if (chained) {
+    // The sample counter, segment and tone phase carry on
+  } else if (!src->is_live) {
+    src->time_base = 0;
+    src->sample_offset = 0;
+
+    // Reset segment
+    gst_segment_init(&src->segment, GST_FORMAT_TIME);
+
+    if (was_playing) {
+      // Send new segment, from the streaming thread when rendering on the
+      // pool, ahead of the first buffer rendered after it
+      segment_event = gst_event_new_segment(&src->segment);
+      if (src->pooled) {
+        if (src->pool_segment)
+          gst_event_unref (src->pool_segment);
+        src->pool_segment = segment_event;
+      } else {
+        gst_pad_push_event(GST_BASE_SRC_PAD(src), segment_event);
       }
+    }
+  }
+
+  src->chained = chained;
+
+  // Notify the pipeline of format changes
+  gst_element_post_message(GST_ELEMENT(src),
+      gst_message_new_duration_changed(GST_OBJECT(src)));
+
+  return chained;
+}
+
+static GstStateChangeReturn
+gst_morse_src_change_state (GstElement * element, GstStateChange transition)
+{
+  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+  GstMorseSrc *src = GST_MORSE_SRC (element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_READY;
+      src->playback_complete = FALSE;
+      g_mutex_unlock(&src->lock);
       break;
-    case PROP_WPM:
-      {
-        gint wpm = g_value_get_int (value);
-        if (wpm < MIN_WPM || wpm > MAX_WPM) {
-          GST_WARNING_OBJECT (src, "WPM %d out of range, clamping", wpm);
-          wpm = CLAMP(wpm, MIN_WPM, MAX_WPM);
-        }
-        src->wpm = wpm;
-        
-        // Recalculate timing if audio info is available
-        if (GST_AUDIO_INFO_RATE(&src->info) > 0) {
-          gdouble dot_duration = 1.2 / src->wpm;
-          src->samples_per_dot = (guint)(dot_duration * GST_AUDIO_INFO_RATE(&src->info));
-          if (src->samples_per_dot < 100) {
-            src->samples_per_dot = 100;
-          }
-          src->samples_per_dash = src->samples_per_dot * 3;
-          src->samples_per_space = src->samples_per_dot;
-        }
-      }
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_PAUSED;
+      g_mutex_unlock(&src->lock);
       break;
-    case PROP_TEXT:
-      {
-        const gchar *new_text = g_value_get_string(value);
-        if (!new_text || strlen(new_text) == 0) {
-          GST_WARNING_OBJECT (src, "Empty text provided, ignoring");
-          return;
-        }
-        
-        g_mutex_lock(&src->lock);
-        if (src->pending_text)
-          g_free(src->pending_text);
-        src->pending_text = g_strdup(new_text);
-        src->new_text_pending = TRUE;
-        src->playback_complete = FALSE;
-        g_mutex_unlock(&src->lock);
-      }
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_PLAYING;
+      g_mutex_unlock(&src->lock);
       break;
-    case PROP_ONE_SHOT:
-      src->one_shot = g_value_get_boolean(value);
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_morse_src_parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_PAUSED;
+      g_mutex_unlock(&src->lock);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_READY;
+      g_mutex_unlock(&src->lock);
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_morse_src_lock (src);
+      src->state = GST_STATE_NULL;
+      g_mutex_unlock(&src->lock);
       break;
     default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
+  }
+
+  return ret;
+}
+
+// Append a run, merging adjacent gaps. While counting (runs == NULL) only
+// the number of runs is tracked.
+static void
+morse_code_emit (MorseCode *code, gboolean key, guint units)
+{
+  code->units += units;
+
+  while (units > 0) {
+    guint n = MIN (units, MORSE_RUN_UNITS);
+
+    if (!key && code->n_runs > 0 && !MORSE_RUN_IS_KEY (code->last) &&
+        MORSE_RUN_LENGTH (code->last) + n <= MORSE_RUN_UNITS) {
+      code->last += n;
+      if (code->runs)
+        code->runs[code->n_runs - 1] = code->last;
+    } else {
+      code->last = (key ? MORSE_RUN_KEY : 0) | n;
+      if (code->runs)
+        code->runs[code->n_runs] = code->last;
+      code->n_runs++;
+    }
+    units -= n;
+  }
+}
+
+// Encode whole characters from the cursor while another one fits in
+// `limit` runs. When the text runs out the closing word gap is added.
+static void
+morse_code_encode (MorseCode *code, guint limit)
+{
+  MorseSymbol symbol;
+  guint n;
+
+  while (code->cursor < code->end &&
+      code->n_runs + MORSE_CHAR_RUNS_MAX <= limit)
+    {
+      switch (morse_table_next (code->table, &code->cursor, code->end,
+              &symbol))
+        {
+          case MORSE_TOKEN_SPACE:
+            morse_code_emit (code, FALSE, code->word_gap);
+            break;
+          case MORSE_TOKEN_SYMBOL:
+            for (n = 0; n < symbol.length; n++)
+              {
+                morse_code_emit (code, FALSE, 1);
+                morse_code_emit (code, TRUE, (symbol.bits >> n) & 1 ? 3 : 1);
+              }
+            morse_code_emit (code, FALSE, code->char_gap);
+            break;
+          case MORSE_TOKEN_SKIP:
+            break;
+        }
+    }
+
+  if (code->cursor == code->end && !code->open && !code->done)
+    {
+      morse_code_emit (code, FALSE, code->word_gap + 1);
+      code->done = TRUE;
+    }
+}
+
+// Encode the first window of the `len` bytes at `str` with `table`, with
+// `char_gap` units after each character and `word_gap` per space. A
+// counting pass over that window sizes the single allocation, texts shorter
+// than a window get exactly their runs.
+static MorseCode *
+morse_code_new (MorseTable *table, const gchar *str, gsize len, gboolean open,
+    guint char_gap, guint word_gap)
+{
+  MorseCode count = { str, str, str + len, open, FALSE, FALSE, NULL,
+    NULL, 0, 0, 0, 0, 0, char_gap, word_gap, table };
+  MorseCode *code;
+  guint capacity;
+
+  morse_code_encode (&count, MORSE_CODE_WINDOW);
+  capacity = count.done ? count.n_runs : MORSE_CODE_WINDOW;
+
+  code = g_malloc0 (sizeof (MorseCode) + capacity);
+  code->text = str;
+  code->cursor = str;
+  code->end = str + len;
+  code->open = open;
+  code->indexable = !open;
+  code->runs = (guint8 *) (code + 1);
+  code->capacity = capacity;
+  code->char_gap = char_gap;
+  code->word_gap = word_gap;
+  code->table = morse_table_ref (table);
+  // Same limit as the counting pass, so exactly `capacity` runs come out
+  morse_code_encode (code, MORSE_CODE_WINDOW);
+
+  return code;
+}
+
+// Step past the run at `*position`. Once half the window is played the
+// remaining runs move to the front and more text is encoded behind them.
+static void
+morse_code_advance (MorseCode *code, guint *position)
+{
+  code->played += MORSE_RUN_LENGTH (code->runs[*position]);
+  (*position)++;
+
+  if (code->done || *position < code->capacity / 2)
+    return;
+
+  memmove (code->runs, code->runs + *position, code->n_runs - *position);
+  code->n_runs -= *position;
+  *position = 0;
+  morse_code_encode (code, code->capacity);
+}
+
+// Continue an open code with the next `len` bytes once everything before
+// them has been encoded
+static void
+morse_code_feed (MorseCode *code, const gchar *str, gsize len)
+{
+  g_return_if_fail (code->open && code->cursor == code->end);
+
+  // The last gap may already be played, start a new run instead of
+  // growing it
+  code->last = MORSE_RUN_KEY;
+  code->text = str;
+  code->cursor = str;
+  code->end = str + len;
+  morse_code_encode (code, MORSE_CODE_WINDOW);
+}
+
+// No more text follows, add the closing gap
+static void
+morse_code_close (MorseCode *code)
+{
+  code->open = FALSE;
+  code->last = MORSE_RUN_KEY;
+  morse_code_encode (code, MORSE_CODE_WINDOW);
+}
+
+// Everything encoded is played and an open code is waiting for text
+static gboolean
+morse_code_starved (MorseCode *code, guint position)
+{
+  return position >= code->n_runs && !code->done;
+}
+
+// Dot units a token adds to the stream, matching morse_code_encode
+static guint
+morse_char_units (MorseCode *code, MorseToken token,
+    const MorseSymbol *symbol)
+{
+  guint n, keyed = 0;
+
+  if (token == MORSE_TOKEN_SPACE)
+    return code->word_gap;
+  if (token == MORSE_TOKEN_SKIP)
+    return 0;
+
+  for (n = 0; n < symbol->length; n++)
+    keyed += (symbol->bits >> n) & 1 ? 3 : 1;
+
+  // A gap before every symbol and one after the character
+  return symbol->length + code->char_gap + keyed;
+}
+
+// Walk the whole text once, summing units per character. Codes fed from
+// the sink pad have no fixed text and cannot be indexed.
+static MorseIndex *
+morse_code_get_index (MorseCode *code)
+{
+  MorseIndex *index;
+  const gchar *p;
+  MorseSymbol symbol;
+  gsize len, next = 0;
+  guint64 units = 0;
+
+  if (code->index || !code->indexable)
+    return code->index;
+
+  len = code->end - code->text;
+  index = g_malloc0 (sizeof (MorseIndex) +
+      (len / MORSE_INDEX_STRIDE + 1) * sizeof (MorseCheckpoint));
+  index->n_points = 0;
+
+  for (p = code->text; p < code->end;) {
+    MorseToken token;
+
+    if ((gsize) (p - code->text) >= next) {
+      index->points[index->n_points].offset = p - code->text;
+      index->points[index->n_points].units = units;
+      index->n_points++;
+      next += MORSE_INDEX_STRIDE;
+    }
+
+    token = morse_table_next (code->table, &p, code->end, &symbol);
+    units += morse_char_units (code, token, &symbol);
+  }
+
+  if (index->n_points == 0) {
+    index->points[0].offset = 0;
+    index->points[0].units = 0;
+    index->n_points = 1;
+  }
+
+  // Closing word gap
+  index->units = units + code->word_gap + 1;
+  code->index = index;
+
+  return index;
+}
+
+// Samples of a keyed run of `len` units starting at dot unit `unit`
+static guint64
+morse_grid_keyed (const MorseGrid *grid, guint64 unit, guint len)
+{
+  if (!grid->exact)
+    return (guint64) len * grid->dot;
+  return gst_util_uint64_scale (unit + len, grid->num, grid->den) -
+      gst_util_uint64_scale (unit, grid->num, grid->den);
+}
+
+// Count the key-down samples before every checkpoint on `grid`, walking
+// the elements of each character like morse_code_encode emits them
+static void
+morse_index_set_grid (MorseCode *code, MorseIndex *index,
+    const MorseGrid *grid)
+{
+  const gchar *p;
+  MorseSymbol symbol;
+  guint64 unit = 0, keyed = 0;
+  guint i = 0;
+
+  if (index->grid.den == grid->den && index->grid.num == grid->num &&
+      index->grid.dot == grid->dot && index->grid.exact == grid->exact)
+    return;
+
+  for (p = code->text; i < index->n_points;) {
+    if ((gsize) (p - code->text) == index->points[i].offset)
+      index->points[i++].keyed = keyed;
+    if (p >= code->end)
+      break;
+
+    switch (morse_table_next (code->table, &p, code->end, &symbol)) {
+      case MORSE_TOKEN_SPACE:
+        unit += code->word_gap;
+        break;
+      case MORSE_TOKEN_SYMBOL:
+        for (guint n = 0; n < symbol.length; n++) {
+          guint len = (symbol.bits >> n) & 1 ? 3 : 1;
+
+          unit++;
+          keyed += morse_grid_keyed (grid, unit, len);
+          unit += len;
+        }
+        unit += code->char_gap;
+        break;
+      case MORSE_TOKEN_SKIP:
+        break;
+    }
+  }
+
+  index->grid = *grid;
+}
+
+// Re-encode a closed code from the checkpoint at or before dot unit `unit`
+// and find the run holding it. Returns the units played and the key-down
+// samples on `grid` before that run. Seeking to 0 needs no index.
+static gboolean
+morse_code_seek (MorseCode *code, guint64 unit, const MorseGrid *grid,
+    guint *position, guint64 *run_unit, guint64 *keyed)
+{
+  MorseIndex *index = NULL;
+  guint lo = 0, i;
+
+  if (unit > 0) {
+    guint hi;
+
+    if (!(index = morse_code_get_index (code)))
+      return FALSE;
+    morse_index_set_grid (code, index, grid);
+
+    hi = index->n_points - 1;
+    while (lo < hi) {
+      guint mid = (lo + hi + 1) / 2;
+
+      if (index->points[mid].units <= unit)
+        lo = mid;
+      else
+        hi = mid - 1;
     }
+  }
+
+  code->cursor = code->text + (index ? index->points[lo].offset : 0);
+  code->done = FALSE;
+  code->n_runs = 0;
+  code->last = MORSE_RUN_KEY;
+  code->units = index ? index->points[lo].units : 0;
+  code->played = code->units;
+  *keyed = index ? index->points[lo].keyed : 0;
+  morse_code_encode (code, MORSE_CODE_WINDOW);
+
+  // A stride of text always fits in the window
+  for (i = 0; i < code->n_runs; i++) {
+    guint len = MORSE_RUN_LENGTH (code->runs[i]);
+
+    if (code->played + len > unit)
+      break;
+    if (MORSE_RUN_IS_KEY (code->runs[i]))
+      *keyed += morse_grid_keyed (grid, code->played, len);
+    code->played += len;
+  }
+
+  *position = i;
+  *run_unit = code->played;
+  return TRUE;
+}
+
+static void
+morse_code_free (MorseCode *code)
+{
+  morse_table_unref (code->table);
+  g_free (code->index);
+  g_free (code);
+}
+
+static void
+morse_voice_free (MorseVoice *voice)
+{
+  if (voice->code)
+    morse_code_free (voice->code);
+  if (voice->table)
+    morse_table_unref (voice->table);
+  g_free (voice->gains);
+  g_free (voice->text);
+  g_free (voice);
+}
+
+// Start the voice's text again from its first character
+static void
+morse_voice_rewind (MorseVoice *voice)
+{
+  if (voice->code)
+    morse_code_free (voice->code);
+  voice->code = morse_code_new (voice->table, voice->text,
+      strlen (voice->text), FALSE, MORSE_CHAR_GAP, MORSE_WORD_GAP);
+  voice->position = 0;
+  voice->symbol_offset = 0;
+  voice->text_samples = 0;
+  voice->phase = 0.0;
+  voice->finished = FALSE;
+}
+
+// Numeric field written either as an integer or as a double
+static gboolean
+morse_structure_get_number (const GstStructure *s, const gchar *field,
+    gdouble *number)
+{
+  const GValue *value = gst_structure_get_value (s, field);
+
+  if (value && G_VALUE_HOLDS_DOUBLE (value))
+    *number = g_value_get_double (value);
+  else if (value && G_VALUE_HOLDS_INT (value))
+    *number = g_value_get_int (value);
+  else
+    return FALSE;
+  return TRUE;
+}
+
+// Parse "voice, text=..., frequency=..., wpm=..., volume=..., pan=...,
+// channel=..., repeat=...; voice, ..." into an array of voices, NULL when
+// the description is malformed. Texts are encoded with `table`, `channels`
+// receives the channel count the pans and channel numbers need.
+static GPtrArray *
+morse_voices_parse (MorseTable *table, const gchar *desc, gint max_wpm,
+    guint *channels)
+{
+  GPtrArray *voices =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) morse_voice_free);
+  const gchar *p = desc;
+
+  *channels = 1;
+
+  while (p && *p) {
+    GstStructure *s;
+    MorseVoice *voice;
+    const gchar *text;
+    gchar *end = NULL;
+    gdouble number;
+
+    while (g_ascii_isspace (*p) || *p == ';')
+      p++;
+    if (!*p)
+      break;
+
+    if (!(s = gst_structure_from_string (p, &end)))
+      goto invalid;
+
+    text = gst_structure_get_string (s, "text");
+    if (!text || !*text) {
+      gst_structure_free (s);
+      goto invalid;
+    }
+
+    voice = g_new0 (MorseVoice, 1);
+    voice->text = g_strdup (text);
+    voice->table = morse_table_ref (table);
+    voice->volume = -1.0;
+    voice->channel = -1;
+
+    if (morse_structure_get_number (s, "frequency", &number))
+      voice->frequency = CLAMP (number, MIN_FREQUENCY, MAX_FREQUENCY);
+    if (morse_structure_get_number (s, "volume", &number))
+      voice->volume = CLAMP (number, MIN_VOLUME, MAX_VOLUME);
+    if (morse_structure_get_number (s, "wpm", &number))
+      voice->wpm = CLAMP ((gint) number, MIN_WPM, max_wpm);
+    if (morse_structure_get_number (s, "pan", &number)) {
+      voice->pan = CLAMP (number, -1.0, 1.0);
+      voice->panned = TRUE;
+      *channels = MAX (*channels, 2);
+    }
+    if (gst_structure_get_int (s, "channel", &voice->channel) &&
+        voice->channel >= 0)
+      *channels = MAX (*channels, (guint) voice->channel + 1);
+    gst_structure_get_boolean (s, "repeat", &voice->repeat);
+
+    g_ptr_array_add (voices, voice);
+    gst_structure_free (s);
+    p = end;
+  }
+
+  return voices;
+
+ invalid:
+  g_ptr_array_unref (voices);
+  return NULL;
+}
+
+// Shared sine table for the wavetable engine, filled once per process
+static gdouble morse_wavetable[MORSE_WAVETABLE_SIZE + 1];
+
+static void
+morse_wavetable_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    for (gint i = 0; i <= MORSE_WAVETABLE_SIZE; i++)
+      morse_wavetable[i] = sin (2.0 * G_PI * i / MORSE_WAVETABLE_SIZE);
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+// Render `samples` mono sine values starting at *phase and advance the
+// phase so the next block continues where this one stopped.
+static void
+morse_fill_tone (GstMorseOscillator oscillator, gdouble *phase,
+    gdouble increment, gdouble *tone, gint samples)
+{
+  switch (oscillator) {
+    case GST_MORSE_OSCILLATOR_WAVETABLE:
+      {
+        const gdouble to_index = MORSE_WAVETABLE_SIZE / (2.0 * G_PI);
+        gdouble pos = fmod (*phase * to_index, MORSE_WAVETABLE_SIZE);
+        gdouble step = fmod (increment * to_index, MORSE_WAVETABLE_SIZE);
+
+        // A tone at or above the rate steps a whole table or more, and a
+        // chirp or drift can turn the phase backwards. Both are brought
+        // into the table once so the single wrap below suffices.
+        if (pos < 0.0)
+          pos += MORSE_WAVETABLE_SIZE;
+        if (step < 0.0)
+          step += MORSE_WAVETABLE_SIZE;
+
+        for (gint i = 0; i < samples; i++) {
+          // A position rounding up to the table size reads the last pair
+          gint idx = MIN ((gint) pos, MORSE_WAVETABLE_SIZE - 1);
+          gdouble frac = pos - idx;
+
+          tone[i] = morse_wavetable[idx] +
+              frac * (morse_wavetable[idx + 1] - morse_wavetable[idx]);
+          pos += step;
+          if (pos >= MORSE_WAVETABLE_SIZE)
+            pos -= MORSE_WAVETABLE_SIZE;
+        }
+        *phase = pos / to_index;
+      }
+      break;
+    case GST_MORSE_OSCILLATOR_RECURSIVE:
+      {
+        // Each block restarts the phasor from the exact phase, which keeps
+        // its magnitude renormalised without a per-sample correction.
+        gdouble c = cos (*phase), s = sin (*phase);
+        gdouble rc = cos (increment), rs = sin (increment);
+
+        for (gint i = 0; i < samples; i++) {
+          gdouble t = c * rc - s * rs;
+
+          tone[i] = s;
+          s = s * rc + c * rs;
+          c = t;
+        }
+        *phase = fmod (*phase + samples * increment, 2.0 * G_PI);
+      }
+      break;
+    case GST_MORSE_OSCILLATOR_SIN:
+    default:
+      for (gint i = 0; i < samples; i++) {
+        tone[i] = sin (*phase);
+        *phase += increment;
+        if (*phase >= 2.0 * G_PI)
+          *phase -= 2.0 * G_PI;
+      }
+      break;
+  }
+}
+
+// Render a block of the carrier starting `first` samples into its element,
+// then glide volume and frequency past it
+static void
+gst_morse_src_fill_tone (GstMorseSrc *src, gdouble *tone, gint samples,
+    gint first)
+{
+  gdouble increment = src->phase_increment;
+
+  if (src->mute) {
+    memset (tone, 0, samples * sizeof (gdouble));
+  } else {
+    // A chirping transmitter starts off frequency at key-down and settles
+    if (src->chirp > 0.0) {
+      gint rate = GST_AUDIO_INFO_RATE (&src->info);
+
+      increment += 2.0 * G_PI * src->chirp *
+          exp (-first / (MORSE_CHIRP_TIME * rate)) / rate;
+    }
+    morse_fill_tone (src->oscillator, &src->phase, increment, tone, samples);
+  }
+  src->level += src->volume_slope * samples;
+  src->phase_increment += src->increment_slope * samples;
+}
+
+// Add the simulated noise to a block shaped to full scale `scale`, clipped
+// like a receiver would
+static void
+gst_morse_src_add_noise (GstMorseSrc *src, gdouble *tone, gint n,
+    gdouble scale)
+{
+  if (src->noise_sigma <= 0.0)
+    return;
+
+  morse_channel_noise (&src->channel, tone, n, src->noise_sigma * scale);
+  for (gint k = 0; k < n; k++)
+    tone[k] = CLAMP (tone[k], -scale, scale);
+}
+
+// Volume and frequency `offset` samples into the buffer being produced
+static void
+gst_morse_src_glide_to (GstMorseSrc *src, guint offset)
+{
+  src->level = src->control_volume + src->volume_slope * offset;
+  src->phase_increment = src->control_increment +
+      src->increment_slope * offset;
+}
+
+// The grid keyed runs of the message are played on, see
+// gst_morse_src_run_samples
+static MorseGrid
+gst_morse_src_grid (GstMorseSrc *src)
+{
+  MorseGrid grid = { src->dot_num, src->dot_den, src->samples_per_dot,
+    src->high_speed && src->dot_den > 0 };
+
+  return grid;
+}
+
+// Voices key whole dots, whatever the speed
+static MorseGrid
+morse_voice_grid (const MorseVoice *voice)
+{
+  MorseGrid grid = { voice->dot_num, voice->dot_den, voice->samples_per_dot,
+    FALSE };
+
+  return grid;
+}
+
+// Ramp length for an element of `samples` at `rate`, rise-time capped at
+// half the element
+static gint
+gst_morse_src_fade_samples (GstMorseSrc *src, gint rate, gint samples)
+{
+  gint fade = gst_util_uint64_scale_int (src->rise_time, rate, GST_SECOND);
+
+  return MIN (fade, samples / 2);
+}
+
+// Envelope value `i` samples into a rise of `fade` samples
+static gdouble
+morse_envelope_value (GstMorseEnvelope shape, gint i, gint fade)
+{
+  gdouble x = (gdouble) i / fade;
+
+  switch (shape) {
+    case GST_MORSE_ENVELOPE_RAISED_COSINE:
+      return 0.5 - 0.5 * cos (G_PI * x);
+    case GST_MORSE_ENVELOPE_BLACKMAN:
+      return 0.42 - 0.5 * cos (G_PI * x) + 0.08 * cos (2.0 * G_PI * x);
+    case GST_MORSE_ENVELOPE_LINEAR:
+    default:
+      return x;
+  }
+}
+
+static const gdouble *
+gst_morse_src_envelope_find (GstMorseSrc *src, gint fade)
+{
+  for (guint slot = 0; slot < MORSE_ENVELOPE_SLOTS; slot++)
+    if (src->envelopes[slot].table && src->envelopes[slot].fade == fade)
+      return src->envelopes[slot].table;
+  return NULL;
+}
+
+// Rise and fall table for ramps of `fade` samples, laid out as the shape
+// kernels expect it, in the next slot
+static const gdouble *
+gst_morse_src_envelope_build (GstMorseSrc *src, gint fade)
+{
+  guint slot = src->envelope_next++ % MORSE_ENVELOPE_SLOTS;
+  gdouble *table;
+
+  g_free (src->envelopes[slot].table);
+  table = g_new (gdouble, MAX (2 * fade, 1));
+  for (gint i = 0; i < fade; i++) {
+    table[i] = morse_envelope_value (src->envelope, i, fade);
+    table[fade + i] = morse_envelope_value (src->envelope, fade - i, fade);
+  }
+  src->envelopes[slot].fade = fade;
+  src->envelopes[slot].table = table;
+
+  GST_DEBUG_OBJECT (src, "envelope table for %d sample ramps", fade);
+  return table;
+}
+
+// Tables for the dot and dash ramps of keyed runs on `grid` at `rate`. On
+// the exact grid a run can be a sample longer than its floor.
+static void
+gst_morse_src_prepare_ramps (GstMorseSrc *src, gint rate,
+    const MorseGrid *grid)
+{
+  for (guint len = 1; len <= 3; len += 2) {
+    guint64 samples = grid->exact
+        ? gst_util_uint64_scale (len, grid->num, grid->den)
+        : (guint64) len * grid->dot;
+
+    for (guint extra = 0; extra <= (grid->exact ? 1 : 0); extra++) {
+      gint fade = gst_morse_src_fade_samples (src, rate, samples + extra);
+
+      if (!gst_morse_src_envelope_find (src, fade))
+        gst_morse_src_envelope_build (src, fade);
+    }
+  }
+}
+
+// Drop the tables after rise-time or envelope changed and build the ones
+// the message and every voice play with, before the generators need them
+static void
+gst_morse_src_envelope_reset (GstMorseSrc *src)
+{
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+
+  if (!g_atomic_int_get (&src->envelope_dirty))
+    return;
+
+  // Cleared before the shape is read, like timing_dirty
+  g_atomic_int_set (&src->envelope_dirty, FALSE);
+  for (guint slot = 0; slot < MORSE_ENVELOPE_SLOTS; slot++) {
+    g_free (src->envelopes[slot].table);
+    src->envelopes[slot].table = NULL;
+  }
+
+  if (rate > 0 && src->dot_den > 0) {
+    MorseGrid grid = gst_morse_src_grid (src);
+
+    gst_morse_src_prepare_ramps (src, rate, &grid);
+  }
+  for (guint v = 0; src->voices && v < src->voices->len; v++) {
+    MorseVoice *voice = g_ptr_array_index (src->voices, v);
+    MorseGrid grid = morse_voice_grid (voice);
+
+    if (voice->rate > 0)
+      gst_morse_src_prepare_ramps (src, voice->rate, &grid);
+  }
+}
+
+// Table for ramps of `fade` samples. The ramps of the current timing are
+// built ahead by gst_morse_src_prepare_ramps, a miss here allocates.
+static const gdouble *
+gst_morse_src_envelope (GstMorseSrc *src, gint fade)
+{
+  const gdouble *table = gst_morse_src_envelope_find (src, fade);
+
+  if (table)
+    return table;
+
+  MORSE_STAT_ADD (src, allocations, 1);
+  return gst_morse_src_envelope_build (src, fade);
+}
+
+// Apply gain and the envelope like the generators do, through the
+// vectorised kernel when one is selected. Only the block bounds are
+// compared, every sample is a multiply.
+static void
+gst_morse_src_shape_tone (GstMorseSrc *src, gdouble *tone, gint n,
+    gint first, gint samples, gint fade, gdouble gain)
+{
+  const gdouble *envelope = gst_morse_src_envelope (src, fade);
+  gint in_end = CLAMP (fade - first, 0, n);
+  gint out_start = CLAMP (samples - fade + 1 - first, 0, n);
+  gint down = first - samples + 2 * fade;
+  gint k = 0;
+
+  if (src->kernels) {
+    src->kernels->shape (tone, n, first, samples, envelope, fade, gain);
+    return;
+  }
+
+  for (; k < in_end; k++)
+    tone[k] = gain * envelope[first + k] * tone[k];
+  for (; k < out_start; k++)
+    tone[k] = gain * tone[k];
+  for (; k < n; k++)
+    tone[k] = gain * envelope[down + k] * tone[k];
+}
+
+// Define the macro for generating morse code with envelope shaping
+// (rise-time ramps from the envelope tables)
+#define CW_GENERATOR(sample_t, scale)                                  \
+static void                                                            \
+MORSE_CW_GENERATE_##sample_t (GstMorseSrc *src, guint8 *buf,          \
+                             gint first, gint count, gint samples)     \
+{                                                                      \
+  sample_t *data = (sample_t *) buf;                                   \
+  gint channels = GST_AUDIO_INFO_CHANNELS (&src->info);                \
+  /* Ramp length from rise-time, at most half the element */          \
+  gint fade_samples = gst_morse_src_fade_samples (src,                 \
+      GST_AUDIO_INFO_RATE (&src->info), samples);                      \
+                                                                       \
+  for (gint off = 0; off < count; off += MORSE_TONE_BLOCK) {           \
+    gint n = MIN (MORSE_TONE_BLOCK, count - off);                      \
+    gdouble gain = src->level * scale;                                 \
+                                                                       \
+    /* Render the mono tone once, then fan it out to every channel */  \
+    gst_morse_src_fill_tone (src, src->tone, n, first + off);          \
+    gst_morse_src_shape_tone (src, src->tone, n, first + off, samples, \
+        fade_samples, gain);                                           \
+    gst_morse_src_add_noise (src, src->tone, n, scale);                \
+                                                                       \
+    for (gint k = 0; k < n; k++) {                                     \
+      sample_t sample = src->tone[k];                                  \
+                                                                       \
+      for (gint j = 0; j < channels; j++)                              \
+        data[(off + k) * channels + j] = sample;                       \
+    }                                                                  \
+  }                                                                    \
+}
+
+
+// Same generator on top of the vectorised kernels picked in setcaps. The
+// scalar CW_GENERATOR above stays the reference and the fallback.
+#define CW_GENERATOR_SIMD(sample_t, scale, store)                      \
+static void                                                            \
+MORSE_CW_GENERATE_SIMD_##sample_t (GstMorseSrc *src, guint8 *buf,     \
+                                  gint first, gint count, gint samples) \
+{                                                                      \
+  sample_t *data = (sample_t *) buf;                                   \
+  gint channels = GST_AUDIO_INFO_CHANNELS (&src->info);                \
+  gint fade_samples = gst_morse_src_fade_samples (src,                 \
+      GST_AUDIO_INFO_RATE (&src->info), samples);                      \
+                                                                       \
+  for (gint off = 0; off < count; off += MORSE_TONE_BLOCK) {           \
+    gint n = MIN (MORSE_TONE_BLOCK, count - off);                      \
+    gdouble gain = src->level * scale;                                 \
+                                                                       \
+    gst_morse_src_fill_tone (src, src->tone, n, first + off);          \
+    gst_morse_src_shape_tone (src, src->tone, n, first + off, samples, \
+        fade_samples, gain);                                           \
+    gst_morse_src_add_noise (src, src->tone, n, scale);                \
+    src->kernels->store (data + off * channels, src->tone, n, channels); \
+  }                                                                    \
+}
+
+// Generate morse code for different sample types
+CW_GENERATOR (gint16, 32767.0)
+CW_GENERATOR (gint32, 2147483647.0)
+CW_GENERATOR (gfloat, 1.0)
+CW_GENERATOR (gdouble, 1.0)
+
+CW_GENERATOR_SIMD (gint16, 32767.0, store_s16)
+CW_GENERATOR_SIMD (gint32, 2147483647.0, store_s32)
+CW_GENERATOR_SIMD (gfloat, 1.0, store_f32)
+CW_GENERATOR_SIMD (gdouble, 1.0, store_f64)
+
+// Convert the interleaved voice mix to the output sample type, clipping
+// where voices add up past full scale
+#define MORSE_MIX_STORE(sample_t, scale)                               \
+static void                                                            \
+MORSE_MIX_STORE_##sample_t (guint8 *buf, const gdouble *mix, gint n)  \
+{                                                                      \
+  sample_t *data = (sample_t *) buf;                                   \
+                                                                       \
+  for (gint i = 0; i < n; i++)                                         \
+    data[i] = CLAMP (mix[i], -1.0, 1.0) * scale;                       \
+}
+
+MORSE_MIX_STORE (gint16, 32767.0)
+MORSE_MIX_STORE (gint32, 2147483647.0)
+MORSE_MIX_STORE (gfloat, 1.0)
+MORSE_MIX_STORE (gdouble, 1.0)
+
+// Generator and mix store writing one format byte by byte, for the packed,
+// unsigned and byte-swapped formats the sample kernels do not produce.
+// `write` stores the shaped sample `v` (full scale is +-1.0) at `p`, so the
+// samples never take a second pass through packfunc.
+#define CW_GENERATOR_DIRECT(name, bytes, write)                        \
+static inline void                                                     \
+morse_write_##name (guint8 *p, gdouble v)                             \
+{                                                                      \
+  write;                                                               \
+}                                                                      \
+                                                                       \
+static void                                                            \
+MORSE_CW_GENERATE_DIRECT_##name (GstMorseSrc *src, guint8 *buf,       \
+                                gint first, gint count, gint samples)  \
+{                                                                      \
+  gint channels = GST_AUDIO_INFO_CHANNELS (&src->info);                \
+  gint fade_samples = gst_morse_src_fade_samples (src,                 \
+      GST_AUDIO_INFO_RATE (&src->info), samples);                      \
+                                                                       \
+  for (gint off = 0; off < count; off += MORSE_TONE_BLOCK) {           \
+    gint n = MIN (MORSE_TONE_BLOCK, count - off);                      \
+    guint8 *p = buf + (gsize) off * channels * (bytes);                \
+    gdouble gain = src->level;                                         \
+                                                                       \
+    gst_morse_src_fill_tone (src, src->tone, n, first + off);          \
+    gst_morse_src_shape_tone (src, src->tone, n, first + off, samples, \
+        fade_samples, gain);                                           \
+    gst_morse_src_add_noise (src, src->tone, n, 1.0);                  \
+    for (gint k = 0; k < n; k++)                                       \
+      for (gint j = 0; j < channels; j++, p += (bytes))                \
+        morse_write_##name (p, src->tone[k]);                          \
+  }                                                                    \
+}                                                                      \
+                                                                       \
+static void                                                            \
+MORSE_MIX_STORE_DIRECT_##name (guint8 *buf, const gdouble *mix, gint n) \
+{                                                                      \
+  for (gint i = 0; i < n; i++)                                         \
+    morse_write_##name (buf + (gsize) i * (bytes),                     \
+        CLAMP (mix[i], -1.0, 1.0));                                    \
+}
+
+#define MORSE_S(v, scale) ((gint32) ((v) * (scale)))
+
+CW_GENERATOR_DIRECT (S8, 1, *p = (gint8) MORSE_S (v, 127.0))
+CW_GENERATOR_DIRECT (U8, 1, *p = (guint8) MORSE_S (v, 127.0) ^ 0x80)
+CW_GENERATOR_DIRECT (S16LE, 2, GST_WRITE_UINT16_LE (p, MORSE_S (v, 32767.0)))
+CW_GENERATOR_DIRECT (S16BE, 2, GST_WRITE_UINT16_BE (p, MORSE_S (v, 32767.0)))
+CW_GENERATOR_DIRECT (U16LE, 2,
+    GST_WRITE_UINT16_LE (p, MORSE_S (v, 32767.0) ^ 0x8000))
+CW_GENERATOR_DIRECT (U16BE, 2,
+    GST_WRITE_UINT16_BE (p, MORSE_S (v, 32767.0) ^ 0x8000))
+CW_GENERATOR_DIRECT (S24_32LE, 4,
+    GST_WRITE_UINT32_LE (p, MORSE_S (v, 8388607.0)))
+CW_GENERATOR_DIRECT (S24_32BE, 4,
+    GST_WRITE_UINT32_BE (p, MORSE_S (v, 8388607.0)))
+CW_GENERATOR_DIRECT (U24_32LE, 4,
+    GST_WRITE_UINT32_LE (p, (MORSE_S (v, 8388607.0) ^ 0x800000) & 0xffffff))
+CW_GENERATOR_DIRECT (U24_32BE, 4,
+    GST_WRITE_UINT32_BE (p, (MORSE_S (v, 8388607.0) ^ 0x800000) & 0xffffff))
+CW_GENERATOR_DIRECT (S32LE, 4,
+    GST_WRITE_UINT32_LE (p, MORSE_S (v, 2147483647.0)))
+CW_GENERATOR_DIRECT (S32BE, 4,
+    GST_WRITE_UINT32_BE (p, MORSE_S (v, 2147483647.0)))
+CW_GENERATOR_DIRECT (U32LE, 4,
+    GST_WRITE_UINT32_LE (p, (guint32) MORSE_S (v, 2147483647.0) ^ 0x80000000))
+CW_GENERATOR_DIRECT (U32BE, 4,
+    GST_WRITE_UINT32_BE (p, (guint32) MORSE_S (v, 2147483647.0) ^ 0x80000000))
+CW_GENERATOR_DIRECT (S24LE, 3, GST_WRITE_UINT24_LE (p, MORSE_S (v, 8388607.0)))
+CW_GENERATOR_DIRECT (S24BE, 3, GST_WRITE_UINT24_BE (p, MORSE_S (v, 8388607.0)))
+CW_GENERATOR_DIRECT (U24LE, 3,
+    GST_WRITE_UINT24_LE (p, MORSE_S (v, 8388607.0) ^ 0x800000))
+CW_GENERATOR_DIRECT (U24BE, 3,
+    GST_WRITE_UINT24_BE (p, MORSE_S (v, 8388607.0) ^ 0x800000))
+CW_GENERATOR_DIRECT (S20LE, 3, GST_WRITE_UINT24_LE (p, MORSE_S (v, 524287.0)))
+CW_GENERATOR_DIRECT (S20BE, 3, GST_WRITE_UINT24_BE (p, MORSE_S (v, 524287.0)))
+CW_GENERATOR_DIRECT (U20LE, 3,
+    GST_WRITE_UINT24_LE (p, (MORSE_S (v, 524287.0) ^ 0x80000) & 0xfffff))
+CW_GENERATOR_DIRECT (U20BE, 3,
+    GST_WRITE_UINT24_BE (p, (MORSE_S (v, 524287.0) ^ 0x80000) & 0xfffff))
+CW_GENERATOR_DIRECT (S18LE, 3, GST_WRITE_UINT24_LE (p, MORSE_S (v, 131071.0)))
+CW_GENERATOR_DIRECT (S18BE, 3, GST_WRITE_UINT24_BE (p, MORSE_S (v, 131071.0)))
+CW_GENERATOR_DIRECT (U18LE, 3,
+    GST_WRITE_UINT24_LE (p, (MORSE_S (v, 131071.0) ^ 0x20000) & 0x3ffff))
+CW_GENERATOR_DIRECT (U18BE, 3,
+    GST_WRITE_UINT24_BE (p, (MORSE_S (v, 131071.0) ^ 0x20000) & 0x3ffff))
+CW_GENERATOR_DIRECT (F32LE, 4, GST_WRITE_FLOAT_LE (p, (gfloat) v))
+CW_GENERATOR_DIRECT (F32BE, 4, GST_WRITE_FLOAT_BE (p, (gfloat) v))
+CW_GENERATOR_DIRECT (F64LE, 8, GST_WRITE_DOUBLE_LE (p, v))
+CW_GENERATOR_DIRECT (F64BE, 8, GST_WRITE_DOUBLE_BE (p, v))
+
+// Direct writers by format. Native S16/S32/F32/F64 never get here, they
+// have the vectorised generators.
+static const struct {
+  GstAudioFormat format;
+  CW_GENERATE_FUNC generate;
+  MORSE_MIX_FUNC mix;
+} morse_direct_formats[] = {
+#define MORSE_DIRECT(name) { GST_AUDIO_FORMAT_##name, \
+  MORSE_CW_GENERATE_DIRECT_##name, MORSE_MIX_STORE_DIRECT_##name }
+  MORSE_DIRECT (S8), MORSE_DIRECT (U8),
+  MORSE_DIRECT (S16LE), MORSE_DIRECT (S16BE),
+  MORSE_DIRECT (U16LE), MORSE_DIRECT (U16BE),
+  MORSE_DIRECT (S24_32LE), MORSE_DIRECT (S24_32BE),
+  MORSE_DIRECT (U24_32LE), MORSE_DIRECT (U24_32BE),
+  MORSE_DIRECT (S32LE), MORSE_DIRECT (S32BE),
+  MORSE_DIRECT (U32LE), MORSE_DIRECT (U32BE),
+  MORSE_DIRECT (S24LE), MORSE_DIRECT (S24BE),
+  MORSE_DIRECT (U24LE), MORSE_DIRECT (U24BE),
+  MORSE_DIRECT (S20LE), MORSE_DIRECT (S20BE),
+  MORSE_DIRECT (U20LE), MORSE_DIRECT (U20BE),
+  MORSE_DIRECT (S18LE), MORSE_DIRECT (S18BE),
+  MORSE_DIRECT (U18LE), MORSE_DIRECT (U18BE),
+  MORSE_DIRECT (F32LE), MORSE_DIRECT (F32BE),
+  MORSE_DIRECT (F64LE), MORSE_DIRECT (F64BE),
+#undef MORSE_DIRECT
+};
+
+// Pick the vectorised generator when kernels are available
+#define CW_GENERATE_SELECT(src, sample_t)                              \
+  ((src)->kernels ? MORSE_CW_GENERATE_SIMD_##sample_t : MORSE_CW_GENERATE_##sample_t)
+
+// Render a dit, a dah and an inter-element gap once in the output format so
+// create() only has to copy them. Every cached element starts keying at
+// phase zero, the envelope ramp keeps that click free.
+static void
+gst_morse_src_build_cache (GstMorseSrc *src)
+{
+  size_t bpf = GST_AUDIO_INFO_BPF (&src->info);
+  size_t unpacked_bpf = src->packfunc
+    ? src->packsize * GST_AUDIO_INFO_CHANNELS (&src->info)
+    : bpf;
+  guint8 *scratch = NULL;
+  gdouble phase = src->phase;
+
+  g_free (src->cache);
+  src->cache = g_malloc ((src->samples_per_dot + src->samples_per_dash) * bpf);
+  src->cache_dot = src->cache;
+  src->cache_dash = src->cache_dot + src->samples_per_dot * bpf;
+
+  if (src->packfunc)
+    scratch = g_malloc (src->samples_per_dash * unpacked_bpf);
+
+  src->phase = 0.0;
+  src->cwfunc (src, scratch ? scratch : src->cache_dot, 0,
+      src->samples_per_dot, src->samples_per_dot);
+  if (scratch)
+    src->packfunc (src->info.finfo, 0, scratch, src->cache_dot,
+        src->samples_per_dot * GST_AUDIO_INFO_CHANNELS (&src->info));
+
+  src->phase = 0.0;
+  src->cwfunc (src, scratch ? scratch : src->cache_dash, 0,
+      src->samples_per_dash, src->samples_per_dash);
+  if (scratch)
+    src->packfunc (src->info.finfo, 0, scratch, src->cache_dash,
+        src->samples_per_dash * GST_AUDIO_INFO_CHANNELS (&src->info));
+
+  src->phase = phase;
+  src->cache_dirty = FALSE;
+  g_free (scratch);
+
+  GST_DEBUG_OBJECT (src, "symbol cache built, %u/%u samples",
+      src->samples_per_dot, src->samples_per_dash);
+}
+
+// Clamp the requested speed to what the mode allows. The streaming thread
+// recalculates timing before the next buffer.
+static void
+gst_morse_src_apply_wpm (GstMorseSrc *src)
+{
+  gint max = src->high_speed ? MAX_HSCW_WPM : MAX_WPM;
+  gint wpm = src->wpm_requested;
+
+  if (wpm < MIN_WPM || wpm > max) {
+    GST_WARNING_OBJECT (src, "WPM %d out of range, clamping", wpm);
+    wpm = CLAMP (wpm, MIN_WPM, max);
+  }
+  src->wpm = wpm;
+  src->cache_dirty = TRUE;
+  g_atomic_int_set (&src->timing_dirty, TRUE);
+}
+
+// A dot lasts 1.2 / wpm seconds, kept as the exact fraction
+// 6 * rate / (5 * wpm) of samples. The dot grid is rebased at the current
+// run so a speed change applies from there on.
+static void
+gst_morse_src_update_timing (GstMorseSrc *src, gint rate)
+{
+  guint min_dot = src->high_speed ? MIN_HSCW_DOT_SAMPLES : MIN_DOT_SAMPLES;
+  MorseGrid grid;
+
+  // Cleared before the speed is read, a change landing meanwhile is
+  // picked up at the next buffer
+  g_atomic_int_set (&src->timing_dirty, FALSE);
+  src->dot_num = 6 * (guint64) rate;
+  src->dot_den = 5 * (guint64) src->wpm;
+  src->samples_per_dot = src->dot_num / src->dot_den;
+
+  // Ensure minimum samples to avoid clicks
+  if (src->samples_per_dot < min_dot) {
+    src->samples_per_dot = min_dot;
+    src->dot_num = min_dot;
+    src->dot_den = 1;
+    GST_WARNING_OBJECT(src, "Dot duration too short, using minimum");
+  }
+
+  src->samples_per_dash = src->samples_per_dot * 3;
+  src->samples_per_space = src->samples_per_dot;
+
+  src->unit_base = src->generated_morse ? src->generated_morse->played : 0;
+  src->sample_base = src->text_samples;
+
+  grid = gst_morse_src_grid (src);
+  gst_morse_src_prepare_ramps (src, rate, &grid);
+}
+
+// Sample of the current text dot unit `unit` starts at on the exact grid
+static guint64
+gst_morse_src_unit_sample (GstMorseSrc *src, guint64 unit)
+{
+  return src->sample_base + gst_util_uint64_scale (unit - src->unit_base,
+      src->dot_num, src->dot_den);
+}
+
+// Samples in the run at src->position. Keyed runs are whole dots so the
+// symbol cache matches them, gaps end on the exact dot grid and absorb
+// the fraction the keyed runs before them dropped. At high speed the
+// dropped fraction is a large part of a dot, so keyed runs end on the grid
+// as well.
+static guint
+gst_morse_src_run_samples (GstMorseSrc *src, guint8 run)
+{
+  guint len = MORSE_RUN_LENGTH (run);
+  guint64 end;
+
+  if ((MORSE_RUN_IS_KEY (run) && !src->high_speed) || src->dot_den == 0)
+    return len * src->samples_per_dot;
+
+  end = gst_morse_src_unit_sample (src, src->generated_morse->played + len);
+  return end > src->text_samples ? end - src->text_samples : 0;
+}
+
+// Samples left of the current text after the ones generated so far, from
+// its precomputed length. G_MAXUINT64 while that is not known, for text
+// streamed from the sink pad until it ends.
+static guint64
+gst_morse_src_remaining_samples (GstMorseSrc *src)
+{
+  MorseCode *code = src->generated_morse;
+  guint64 units = 0, end, now;
+
+  if (!code || src->dot_den == 0)
+    return G_MAXUINT64;
+
+  if (code->done) {
+    units = code->units;
+  } else if (code->indexable) {
+    MorseIndex *index;
+
+    gst_morse_src_lock (src);
+    if ((index = morse_code_get_index (code)))
+      units = index->units;
+    g_mutex_unlock (&src->lock);
+  }
+  if (units == 0)
+    return G_MAXUINT64;
+
+  // The closing gap ends on the dot grid
+  end = gst_morse_src_unit_sample (src, units);
+  now = src->text_samples + src->symbol_offset;
+  return end > now ? end - now : 0;
+}
+
+// Stream time of sample `offset`
+static GstClockTime
+gst_morse_src_sample_time (GstMorseSrc *src, guint64 offset)
+{
+  return src->time_base + gst_util_uint64_scale_int (offset, GST_SECOND,
+      GST_AUDIO_INFO_RATE (&src->info));
+}
+
+// Stamp a buffer of `samples` samples from the counter and advance it
+static void
+gst_morse_src_stamp_buffer (GstMorseSrc *src, GstBuffer *buf, guint samples)
+{
+  GstClockTime start = gst_morse_src_sample_time (src, src->sample_offset);
+
+  GST_BUFFER_OFFSET (buf) = src->sample_offset;
+  GST_BUFFER_OFFSET_END (buf) = src->sample_offset + samples;
+  GST_BUFFER_PTS (buf) = start;
+  GST_BUFFER_DURATION (buf) =
+    gst_morse_src_sample_time (src, src->sample_offset + samples) - start;
+  src->sample_offset += samples;
+
+  MORSE_STAT_ADD (src, buffers, 1);
+  MORSE_STAT_ADD (src, samples, samples);
+}
+
+// Key-down or key-up at `offset`, the sample the element starts or ends.
+// Posted when the buffer holding it is produced, consumers act on the
+// timestamp against the pipeline clock.
+static void
+gst_morse_src_post_keying (GstMorseSrc *src, gboolean key, guint64 offset)
+{
+  GstMessage *message;
+
+  message = gst_message_new_application (GST_OBJECT (src),
+      gst_structure_new ("morse-keying",
+          "source", G_TYPE_STRING, "morsesrc",
+          "key", G_TYPE_BOOLEAN, key,
+          "timestamp", G_TYPE_UINT64, gst_morse_src_sample_time (src, offset),
+          "offset", G_TYPE_UINT64, offset,
+          NULL));
+
+  gst_element_post_message (GST_ELEMENT (src), message);
+}
+
+// Samples per buffer requested through latency-time (live mode),
+// buffer-time or samples-per-buffer, in that order
+static guint
+gst_morse_src_requested_block (GstMorseSrc *src)
+{
+  guint64 duration = src->buffer_time;
+
+  if (src->is_live && src->latency_time > 0)
+    duration = src->latency_time;
+
+  if (duration > 0 && GST_AUDIO_INFO_RATE (&src->info) > 0)
+    return MAX (1, MIN (gst_util_uint64_scale_int (duration,
+                GST_AUDIO_INFO_RATE (&src->info), GST_SECOND), G_MAXUINT));
+  return src->samples_per_buffer;
+}
+
+// Push the requested block size into the GstBaseSrc blocksize once the
+// frame size is known, and have latency and allocation re-evaluated.
+static void
+gst_morse_src_apply_block (GstMorseSrc *src)
+{
+  gint bpf = GST_AUDIO_INFO_BPF (&src->info);
+
+  if (bpf <= 0 || src->user_blocksize)
+    return;
+
+  // Large requests are capped so byte and sample counts stay in a gint
+  gst_base_src_set_blocksize (GST_BASE_SRC (src),
+      MIN (gst_morse_src_requested_block (src), (guint) (G_MAXINT / bpf)) *
+      bpf);
+}
+
+// An application setting blocksize directly wins over our own sizing
+static void
+gst_morse_src_blocksize_notify (GObject *object, GParamSpec *pspec,
+    gpointer user_data)
+{
+  GST_MORSE_SRC (object)->user_blocksize = TRUE;
+}
+
+static void
+gst_morse_src_set_property (GObject *object, guint prop_id,
+                           const GValue *value, GParamSpec *pspec)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (object);
+
+  switch (prop_id)
+    {
+    case PROP_FREQUENCY:
+      {
+        gdouble freq = g_value_get_double (value);
+        if (freq < MIN_FREQUENCY || freq > MAX_FREQUENCY) {
+          GST_WARNING_OBJECT (src, "Frequency %f Hz out of range, clamping", freq);
+          freq = CLAMP(freq, MIN_FREQUENCY, MAX_FREQUENCY);
+        }
+        // The streaming thread picks it up at the next buffer
+        if (freq != src->frequency) {
+          src->frequency = freq;
+          src->cache_dirty = TRUE;
+        }
+      }
+      break;
+    case PROP_VOLUME:
+      {
+        gdouble vol = g_value_get_double (value);
+        if (vol < MIN_VOLUME || vol > MAX_VOLUME) {
+          GST_WARNING_OBJECT (src, "Volume %f out of range, clamping", vol);
+          vol = CLAMP(vol, MIN_VOLUME, MAX_VOLUME);
+        }
+        if (vol != src->volume) {
+          src->volume = vol;
+          src->cache_dirty = TRUE;
+        }
+      }
+      break;
+    case PROP_WPM:
+      // A control binding sets it every buffer, only changes move the grid
+      if (g_value_get_int (value) != src->wpm_requested) {
+        src->wpm_requested = g_value_get_int (value);
+        gst_morse_src_apply_wpm (src);
+      }
+      break;
+    case PROP_TEXT:
+      {
+        const gchar *new_text = g_value_get_string(value);
+
+        if (!new_text || strlen(new_text) == 0) {
+          GST_WARNING_OBJECT (src, "Empty text provided, ignoring");
+          return;
+        }
+
+        // Encoded here and handed to the streaming thread without locking
+        if (gst_morse_src_enqueue_text (src, new_text)) {
+          gst_morse_src_lock (src);
+          g_free (src->text_prop);
+          src->text_prop = g_strdup (new_text);
+          g_mutex_unlock (&src->lock);
+        }
+      }
+      break;
+    case PROP_ONE_SHOT:
+      src->one_shot = g_value_get_boolean(value);
+      break;
+    case PROP_ONE_SHOT_MODE:
+      src->one_shot_mode = g_value_get_enum (value);
+      break;
+    case PROP_ABOUT_TO_FINISH_TIME:
+      src->about_to_finish_time = g_value_get_uint64 (value);
+      break;
+    case PROP_GAPLESS:
+      src->gapless = g_value_get_boolean (value);
+      break;
+    case PROP_OSCILLATOR:
+      src->oscillator = g_value_get_enum (value);
+      break;
+    case PROP_SIMD:
+      // Takes effect at the next caps negotiation
+      src->simd = g_value_get_enum (value);
+      break;
+    case PROP_SYMBOL_CACHE:
+      src->symbol_cache = g_value_get_boolean (value);
+      src->cache_dirty = TRUE;
+      break;
+    case PROP_HIGH_SPEED:
+      src->high_speed = g_value_get_boolean (value);
+      gst_morse_src_apply_wpm (src);
+      break;
+    case PROP_FARNSWORTH_WPM:
+      // Applies to texts set from now on
+      src->farnsworth_wpm = g_value_get_int (value);
+      break;
+    case PROP_TABLE_FILE:
+      {
+        const gchar *path = g_value_get_string (value);
+        MorseTable *table, *old;
+        GError *error = NULL;
+
+        // Applies to texts set from now on, NULL goes back to the built-in
+        // table. A file that fails to load leaves the current table.
+        if (path && *path) {
+          if (!(table = morse_table_load (path, &error))) {
+            GST_WARNING_OBJECT (src, "Cannot load code table: %s",
+                error->message);
+            g_error_free (error);
+            break;
+          }
+        } else {
+          table = morse_table_builtin ();
+          path = NULL;
+        }
+
+        GST_OBJECT_LOCK (src);
+        old = src->table;
+        src->table = table;
+        g_free (src->table_file);
+        src->table_file = g_strdup (path);
+        GST_OBJECT_UNLOCK (src);
+        morse_table_unref (old);
+      }
+      break;
+    case PROP_RISE_TIME:
+      src->rise_time = g_value_get_uint64 (value);
+      g_atomic_int_set (&src->envelope_dirty, TRUE);
+      src->cache_dirty = TRUE;
+      break;
+    case PROP_ENVELOPE:
+      src->envelope = g_value_get_enum (value);
+      g_atomic_int_set (&src->envelope_dirty, TRUE);
+      src->cache_dirty = TRUE;
+      break;
+    case PROP_NOISE:
+      src->noise = g_value_get_boolean (value);
+      break;
+    case PROP_SNR:
+      src->snr = g_value_get_double (value);
+      break;
+    case PROP_FADING:
+      src->fading = g_value_get_enum (value);
+      break;
+    case PROP_FADING_RATE:
+      src->fading_rate = g_value_get_double (value);
+      break;
+    case PROP_CHIRP:
+      src->chirp = g_value_get_double (value);
+      break;
+    case PROP_DRIFT:
+      src->drift = g_value_get_double (value);
+      break;
+    case PROP_SEED:
+      // Used when the element starts
+      src->seed = g_value_get_uint (value);
+      break;
+    case PROP_SAMPLES_PER_BUFFER:
+      src->samples_per_buffer = g_value_get_uint (value);
+      src->user_blocksize = FALSE;
+      gst_morse_src_apply_block (src);
+      break;
+    case PROP_BUFFER_TIME:
+      src->buffer_time = g_value_get_uint64 (value);
+      src->user_blocksize = FALSE;
+      gst_morse_src_apply_block (src);
+      break;
+    case PROP_QUEUE_MODE:
+      src->queue_mode = g_value_get_enum (value);
+      break;
+    case PROP_GAP_MODE:
+      src->gap_mode = g_value_get_enum (value);
+      break;
+    case PROP_KEYING_MESSAGES:
+      src->keying_messages = g_value_get_boolean (value);
+      break;
+    case PROP_RENDER_AUDIO:
+      src->render_audio = g_value_get_boolean (value);
+      break;
+    case PROP_IS_LIVE:
+      src->is_live = g_value_get_boolean (value);
+      gst_base_src_set_live (GST_BASE_SRC (src), src->is_live);
+      gst_morse_src_apply_block (src);
+      break;
+    case PROP_LATENCY_TIME:
+      src->latency_time = g_value_get_uint64 (value);
+      src->user_blocksize = FALSE;
+      gst_morse_src_apply_block (src);
+      break;
+    case PROP_VOICES:
+      {
+        const gchar *desc = g_value_get_string (value);
+        guint channels;
+        MorseTable *table = gst_morse_src_get_table (src);
+        GPtrArray *voices = morse_voices_parse (table, desc,
+            src->high_speed ? MAX_HSCW_WPM : MAX_WPM, &channels);
+
+        morse_table_unref (table);
+        if (!voices) {
+          GST_WARNING_OBJECT (src, "Invalid voices \"%s\", ignoring", desc);
+          return;
+        }
+        if (voices->len == 0) {
+          g_ptr_array_unref (voices);
+          voices = NULL;
+        }
+
+        // Taken over by the streaming thread at the next buffer
+        gst_morse_src_lock (src);
+        if (src->pending_voices)
+          g_ptr_array_unref (src->pending_voices);
+        src->pending_voices = voices;
+        src->voices_changed = TRUE;
+        src->voices_channels = channels;
+        g_free (src->voices_desc);
+        src->voices_desc = voices ? g_strdup (desc) : NULL;
+        g_mutex_unlock (&src->lock);
+
+        g_mutex_lock (&src->stream_lock);
+        g_cond_broadcast (&src->stream_cond);
+        g_mutex_unlock (&src->stream_lock);
+      }
+      break;
+    case PROP_SHARED_CACHE:
+      // Looked at when the next message starts
+      src->shared_cache = g_value_get_boolean (value);
+      break;
+    case PROP_RENDER_POOL:
+      // Looked at when the element starts
+      src->render_pool = g_value_get_boolean (value);
+      break;
+    case PROP_RENDER_AHEAD:
+      g_mutex_lock (&src->stream_lock);
+      src->render_ahead = g_value_get_uint (value);
+      g_mutex_unlock (&src->stream_lock);
+      break;
+    case PROP_SHARED_CACHE_SIZE:
+      g_mutex_lock (&morse_shared_lock);
+      morse_shared_budget = g_value_get_uint64 (value);
+      morse_shared_evict ();
+      g_mutex_unlock (&morse_shared_lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+// Snapshot of the hot path counters for the "stats" property
+static GstStructure *
+gst_morse_src_get_stats (GstMorseSrc *src)
+{
+  return gst_structure_new ("application/x-morsesrc-stats",
+      "buffers", G_TYPE_UINT64, MORSE_STAT_GET (src, buffers),
+      "samples", G_TYPE_UINT64, MORSE_STAT_GET (src, samples),
+      "generate-time", G_TYPE_UINT64, MORSE_STAT_GET (src, generate_time),
+      "pack-time", G_TYPE_UINT64, MORSE_STAT_GET (src, pack_time),
+      "allocations", G_TYPE_UINT64, MORSE_STAT_GET (src, allocations),
+      "texts-applied", G_TYPE_UINT64, MORSE_STAT_GET (src, texts_applied),
+      "texts-dropped", G_TYPE_UINT64, MORSE_STAT_GET (src, texts_dropped),
+      "lock-waits", G_TYPE_UINT64, MORSE_STAT_GET (src, lock_waits),
+      "text-latency", G_TYPE_UINT64, MORSE_STAT_GET (src, text_latency),
+      NULL);
+}
+
+static void
+gst_morse_src_get_property (GObject *object, guint prop_id,
+                           GValue *value, GParamSpec *pspec)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (object);
+
+  switch (prop_id)
+    {
+    case PROP_FREQUENCY:
+      g_value_set_double (value, src->frequency);
+      break;
+    case PROP_VOLUME:
+      g_value_set_double (value, src->volume);
+      break;
+    case PROP_WPM:
+      g_value_set_int (value, src->wpm);
+      break;
+    case PROP_TEXT:
+      gst_morse_src_lock (src);
+      g_value_set_string (value, src->text_prop ? src->text_prop : src->text);
+      g_mutex_unlock(&src->lock);
+      break;
+    case PROP_ONE_SHOT:
+      g_value_set_boolean (value, src->one_shot);
+      break;
+    case PROP_ONE_SHOT_MODE:
+      g_value_set_enum (value, src->one_shot_mode);
+      break;
+    case PROP_ABOUT_TO_FINISH_TIME:
+      g_value_set_uint64 (value, src->about_to_finish_time);
+      break;
+    case PROP_GAPLESS:
+      g_value_set_boolean (value, src->gapless);
+      break;
+    case PROP_OSCILLATOR:
+      g_value_set_enum (value, src->oscillator);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, src->simd);
+      break;
+    case PROP_SYMBOL_CACHE:
+      g_value_set_boolean (value, src->symbol_cache);
+      break;
+    case PROP_HIGH_SPEED:
+      g_value_set_boolean (value, src->high_speed);
+      break;
+    case PROP_FARNSWORTH_WPM:
+      g_value_set_int (value, src->farnsworth_wpm);
+      break;
+    case PROP_TABLE_FILE:
+      GST_OBJECT_LOCK (src);
+      g_value_set_string (value, src->table_file);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_RISE_TIME:
+      g_value_set_uint64 (value, src->rise_time);
+      break;
+    case PROP_ENVELOPE:
+      g_value_set_enum (value, src->envelope);
+      break;
+    case PROP_NOISE:
+      g_value_set_boolean (value, src->noise);
+      break;
+    case PROP_SNR:
+      g_value_set_double (value, src->snr);
+      break;
+    case PROP_FADING:
+      g_value_set_enum (value, src->fading);
+      break;
+    case PROP_FADING_RATE:
+      g_value_set_double (value, src->fading_rate);
+      break;
+    case PROP_CHIRP:
+      g_value_set_double (value, src->chirp);
+      break;
+    case PROP_DRIFT:
+      g_value_set_double (value, src->drift);
+      break;
+    case PROP_SEED:
+      g_value_set_uint (value, src->seed);
+      break;
+    case PROP_SAMPLES_PER_BUFFER:
+      g_value_set_uint (value, src->samples_per_buffer);
+      break;
+    case PROP_BUFFER_TIME:
+      g_value_set_uint64 (value, src->buffer_time);
+      break;
+    case PROP_QUEUE_MODE:
+      g_value_set_enum (value, src->queue_mode);
+      break;
+    case PROP_GAP_MODE:
+      g_value_set_enum (value, src->gap_mode);
+      break;
+    case PROP_KEYING_MESSAGES:
+      g_value_set_boolean (value, src->keying_messages);
+      break;
+    case PROP_RENDER_AUDIO:
+      g_value_set_boolean (value, src->render_audio);
+      break;
+    case PROP_IS_LIVE:
+      g_value_set_boolean (value, src->is_live);
+      break;
+    case PROP_LATENCY_TIME:
+      g_value_set_uint64 (value, src->latency_time);
+      break;
+    case PROP_VOICES:
+      gst_morse_src_lock (src);
+      g_value_set_string (value, src->voices_desc);
+      g_mutex_unlock (&src->lock);
+      break;
+    case PROP_SHARED_CACHE:
+      g_value_set_boolean (value, src->shared_cache);
+      break;
+    case PROP_RENDER_POOL:
+      g_value_set_boolean (value, src->render_pool);
+      break;
+    case PROP_RENDER_AHEAD:
+      g_value_set_uint (value, src->render_ahead);
+      break;
+    case PROP_SHARED_CACHE_SIZE:
+      g_mutex_lock (&morse_shared_lock);
+      g_value_set_uint64 (value, morse_shared_budget);
+      g_mutex_unlock (&morse_shared_lock);
+      break;
+    case PROP_ALLOCATIONS:
+      g_value_set_uint64 (value, MORSE_STAT_GET (src, allocations));
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_morse_src_get_stats (src));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gst_morse_src_stream_release_buffer (GstMorseSrc *src)
+{
+  if (src->stream_buffer) {
+    gst_buffer_unmap (src->stream_buffer, &src->stream_map);
+    gst_buffer_unref (src->stream_buffer);
+    src->stream_buffer = NULL;
+  }
+  g_free (src->stream_joined);
+  src->stream_joined = NULL;
+}
+
+// Bytes at the end of `text` that start a UTF-8 character the next buffer
+// completes, 0 when it ends on a whole or an invalid one
+static gsize
+morse_utf8_cut (const gchar *text, gsize len)
+{
+  for (gsize n = 1; n <= MIN (len, 3); n++) {
+    const gchar *p = text + len - n;
+
+    if (((guchar) *p & 0xc0) != 0x80)
+      return g_utf8_get_char_validated (p, n) == (gunichar) -2 ? n : 0;
+  }
+  return 0;
+}
+
+// A buffer rendered on the pool, or the flow that ended the rendering
+typedef struct {
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+  GstEvent *segment;
+} MorsePoolEntry;
+
+static void
+morse_pool_entry_free (MorsePoolEntry *entry)
+{
+  if (entry->buffer)
+    gst_buffer_unref (entry->buffer);
+  if (entry->segment)
+    gst_event_unref (entry->segment);
+  g_free (entry);
+}
+
+static void gst_morse_src_pool_render (gpointer data, gpointer user_data);
+
+// Renders for every element with "render-pool" set, a thread per core
+// taking jobs from one queue. A job renders one buffer and queues its
+// element again while it has room, so busy elements take turns and idle or
+// full ones cost nothing.
+static GThreadPool *
+morse_render_pool_get (void)
+{
+  static GThreadPool *pool;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized)) {
+    pool = g_thread_pool_new (gst_morse_src_pool_render, NULL,
+        g_get_num_processors (), FALSE, NULL);
+    g_once_init_leave (&initialized, 1);
+  }
+  return pool;
+}
+
+// Queue a job when there is room ahead. Called with stream_lock held.
+static void
+gst_morse_src_pool_schedule (GstMorseSrc *src)
+{
+  if (src->pool_scheduled || src->pool_done || src->pool_flushing ||
+      !src->streaming || src->pool_queue.length >= src->render_ahead)
+    return;
+
+  src->pool_scheduled = TRUE;
+  g_thread_pool_push (morse_render_pool_get (), gst_object_ref (src), NULL);
+}
+
+// One job never runs with another of the same element, so gst_morse_src_
+// produce keeps a single thread at a time as it does streaming
+static void
+gst_morse_src_pool_render (gpointer data, gpointer user_data)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (data);
+
+  g_mutex_lock (&src->stream_lock);
+  if (src->streaming && !src->pool_flushing && !src->pool_done) {
+    MorsePoolEntry *entry = g_new0 (MorsePoolEntry, 1);
+
+    g_mutex_unlock (&src->stream_lock);
+    entry->ret = gst_morse_src_produce (src, &entry->buffer);
+    entry->segment = src->pool_segment;
+    src->pool_segment = NULL;
+    g_mutex_lock (&src->stream_lock);
+
+    g_queue_push_tail (&src->pool_queue, entry);
+    if (entry->ret != GST_FLOW_OK)
+      src->pool_done = TRUE;
+  }
+  src->pool_scheduled = FALSE;
+  gst_morse_src_pool_schedule (src);
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  gst_object_unref (src);
+}
+
+// Take the next rendered buffer, keeping the pool rendering ahead
+static GstFlowReturn
+gst_morse_src_pool_pop (GstMorseSrc *src, GstBuffer **buffer)
+{
+  MorsePoolEntry *entry = NULL;
+  GstFlowReturn ret;
+
+  g_mutex_lock (&src->stream_lock);
+  gst_morse_src_pool_schedule (src);
+  while (src->streaming && !(entry = g_queue_pop_head (&src->pool_queue)))
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+  gst_morse_src_pool_schedule (src);
+  g_mutex_unlock (&src->stream_lock);
+
+  if (!entry)
+    return GST_FLOW_FLUSHING;
+
+  if (entry->segment) {
+    gst_pad_push_event (GST_BASE_SRC_PAD (src), entry->segment);
+    entry->segment = NULL;
+  }
+  ret = entry->ret;
+  *buffer = entry->buffer;
+  entry->buffer = NULL;
+  morse_pool_entry_free (entry);
+
+  return ret;
+}
+
+// Wait for a job in flight after an unlock. What was rendered ahead has
+// its runs consumed already and is kept, only jobs that failed to get a
+// buffer while flushing are dropped, they rendered nothing.
+static void
+gst_morse_src_pool_settle (GstMorseSrc *src)
+{
+  GList *l, *next;
+
+  g_mutex_lock (&src->stream_lock);
+  while (src->pool_scheduled)
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+  for (l = src->pool_queue.head; l; l = next) {
+    MorsePoolEntry *entry = l->data;
+
+    next = l->next;
+    if (entry->ret == GST_FLOW_FLUSHING) {
+      // The segment it picked up goes out ahead of the next buffer
+      if (entry->segment && next && !((MorsePoolEntry *) next->data)->segment) {
+        ((MorsePoolEntry *) next->data)->segment = entry->segment;
+        entry->segment = NULL;
+      } else if (entry->segment && !next && !src->pool_segment) {
+        src->pool_segment = entry->segment;
+        entry->segment = NULL;
+      }
+      morse_pool_entry_free (entry);
+      g_queue_delete_link (&src->pool_queue, l);
+      src->pool_done = FALSE;
+    }
+  }
+  g_mutex_unlock (&src->stream_lock);
+}
+
+// Wait for a job in flight and drop what was rendered ahead, before a seek,
+// stop or new caps changes the state the job works on
+static void
+gst_morse_src_pool_flush (GstMorseSrc *src)
+{
+  g_mutex_lock (&src->stream_lock);
+  src->pool_flushing = TRUE;
+  while (src->pool_scheduled)
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+  g_queue_clear_full (&src->pool_queue, (GDestroyNotify) morse_pool_entry_free);
+  src->pool_done = FALSE;
+  src->pool_flushing = FALSE;
+  g_mutex_unlock (&src->stream_lock);
+
+  if (src->pool_segment) {
+    gst_event_unref (src->pool_segment);
+    src->pool_segment = NULL;
+  }
+}
+
+static void
+gst_morse_src_finalize (GObject * object)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (object);
+
+  gst_morse_src_lock (src);
+
+  // Nothing streams any more, drain the ring from this thread
+  MorseMessage *msg;
+  while ((msg = gst_morse_src_queue_pop (src)))
+    morse_message_free (msg);
+
+  if (src->text) {
+    g_free(src->text);
+    src->text = NULL;
+  }
+  g_free (src->text_prop);
+  src->text_prop = NULL;
+  if (src->generated_morse) {
+    morse_code_free (src->generated_morse);
+    src->generated_morse = NULL;
+  }
+  g_free (src->cache);
+  src->cache = NULL;
+  g_free (src->scratch);
+  src->scratch = NULL;
+  for (guint n = 0; n < MORSE_ENVELOPE_SLOTS; n++)
+    g_free (src->envelopes[n].table);
+  if (src->voices)
+    g_ptr_array_unref (src->voices);
+  if (src->pending_voices)
+    g_ptr_array_unref (src->pending_voices);
+  src->voices = src->pending_voices = NULL;
+  g_free (src->voices_desc);
+  src->voices_desc = NULL;
+  g_free (src->mix);
+  src->mix = NULL;
+  gst_morse_src_shared_reset (src);
+  if (src->silence)
+    gst_memory_unref (src->silence);
+  src->silence = NULL;
+  morse_table_unref (src->table);
+  src->table = NULL;
+  g_free (src->table_file);
+  src->table_file = NULL;
+  
+  g_mutex_unlock(&src->lock);
+  g_mutex_clear(&src->lock);
+
+  g_queue_clear_full (&src->stream_queue, (GDestroyNotify) gst_buffer_unref);
+  gst_morse_src_stream_release_buffer (src);
+  g_queue_clear_full (&src->pool_queue, (GDestroyNotify) morse_pool_entry_free);
+  if (src->pool_segment)
+    gst_event_unref (src->pool_segment);
+  gst_morse_src_encoded_reset (src);
+  if (src->encoder)
+    morse_encoder_free (src->encoder);
+  gst_caps_replace (&src->encoded_caps, NULL);
+  g_cond_clear (&src->stream_cond);
+  g_mutex_clear (&src->stream_lock);
+
+  G_OBJECT_CLASS (gst_morse_src_parent_class)->finalize (object);
+}
+
+// Unpacked intermediate for `block` samples. Its frames of doubles are
+// wider than the output ones, g_malloc_n fails rather than wrapping.
+static void
+gst_morse_src_alloc_scratch (GstMorseSrc *src, guint block)
+{
+  g_free (src->scratch);
+  src->scratch = g_malloc_n (block,
+      src->packsize * GST_AUDIO_INFO_CHANNELS (&src->info));
+  src->scratch_samples = block;
+  MORSE_STAT_ADD (src, allocations, 1);
+}
+
+// Current number of samples per buffer, following the GstBaseSrc
+// blocksize. Grows the scratch area and asks for a new allocation and
+// latency when the size changed since the last buffer.
+static guint
+gst_morse_src_update_block (GstMorseSrc *src)
+{
+  guint block = gst_base_src_get_blocksize (GST_BASE_SRC (src)) /
+      GST_AUDIO_INFO_BPF (&src->info);
+
+  // A blocksize set directly is not capped like our own
+  block = CLAMP (block, 1,
+      (guint) (G_MAXINT / GST_AUDIO_INFO_BPF (&src->info)));
+  if (block == src->block_samples)
+    return block;
+
+  GST_DEBUG_OBJECT (src, "block size changed from %u to %u samples",
+      src->block_samples, block);
+  src->block_samples = block;
+
+  if (src->packfunc && block > src->scratch_samples)
+    gst_morse_src_alloc_scratch (src, block);
+
+  gst_pad_mark_reconfigure (GST_BASE_SRC_PAD (src));
+  gst_element_post_message (GST_ELEMENT (src),
+      gst_message_new_latency (GST_OBJECT (src)));
+
+  return block;
+}
+
+// Take an output buffer from the negotiated pool, falling back to a plain
+// allocation when no usable pool is configured. Every buffer seen for the
+// first time is counted so a steady state without allocations can be
+// verified in the debug log. A pool worker must not wait for a buffer to
+// come back, a small downstream pool would stall every pooled element, so
+// an empty pool is bypassed there.
+static GstFlowReturn
+gst_morse_src_alloc_buffer (GstMorseSrc *src, gsize size, GstBuffer **buffer)
+{
+  GstBufferPool *pool = gst_base_src_get_buffer_pool (GST_BASE_SRC (src));
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *buf = NULL;
+
+  if (src->pooled)
+    params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+  if (pool) {
+    GstFlowReturn ret = gst_buffer_pool_acquire_buffer (pool, &buf, &params);
+    gst_object_unref (pool);
+    if (ret == GST_FLOW_EOS && src->pooled)
+      buf = NULL;
+    else if (ret != GST_FLOW_OK)
+      return ret;
+    if (buf && gst_buffer_get_size (buf) < size) {
+      gst_buffer_unref (buf);
+      buf = NULL;
+    }
+  }
+
+  if (!buf)
+    buf = gst_buffer_new_and_alloc (size);
+
+  if (!gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (buf),
+          morse_buffer_quark)) {
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (buf), morse_buffer_quark,
+        GINT_TO_POINTER (1), NULL);
+    MORSE_STAT_ADD (src, allocations, 1);
+    GST_DEBUG_OBJECT (src, "allocated buffer of %" G_GSIZE_FORMAT
+        " bytes, %" G_GUINT64_FORMAT " allocations so far", size,
+        MORSE_STAT_GET (src, allocations));
+  }
+
+  *buffer = buf;
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_morse_src_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (parent);
+
+  g_mutex_lock (&src->stream_lock);
+  while (g_queue_get_length (&src->stream_queue) >= MORSE_STREAM_QUEUE_SIZE &&
+      !src->stream_stopped && !src->stream_flushing)
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+
+  if (src->stream_stopped || src->stream_flushing) {
+    g_mutex_unlock (&src->stream_lock);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  g_queue_push_tail (&src->stream_queue, buffer);
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  return GST_FLOW_OK;
+}
+
+// Events stop at the sink pad, the audio side has its own segment
+static gboolean
+gst_morse_src_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (parent);
+
+  g_mutex_lock (&src->stream_lock);
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      src->stream_eos = TRUE;
+      break;
+    case GST_EVENT_FLUSH_START:
+      src->stream_flushing = TRUE;
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      src->stream_flushing = FALSE;
+      src->stream_eos = FALSE;
+      g_queue_clear_full (&src->stream_queue,
+          (GDestroyNotify) gst_buffer_unref);
+      break;
+    default:
+      break;
+  }
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
+// Hand the next text buffer from the sink pad to the encoder, closing the
+// code after EOS. Waits for input unless live. Returns FALSE when
+// unlocked for a flush or state change.
+static gboolean
+gst_morse_src_stream_feed (GstMorseSrc *src)
+{
+  GstBuffer *buf;
+  gboolean eos;
+
+  g_mutex_lock (&src->stream_lock);
+  while (!(buf = g_queue_pop_head (&src->stream_queue)) &&
+      !src->stream_eos && src->streaming && !src->is_live)
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+
+  if (!buf && !src->streaming) {
+    g_mutex_unlock (&src->stream_lock);
+    return FALSE;
+  }
+
+  eos = !buf && src->stream_eos;
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  // Every run of the previous buffer has been encoded, it can go
+  gst_morse_src_stream_release_buffer (src);
+
+  if (buf) {
+    const gchar *text;
+    gsize len, cut;
+
+    src->stream_buffer = buf;
+    gst_buffer_map (buf, &src->stream_map, GST_MAP_READ);
+    text = (const gchar *) src->stream_map.data;
+    len = src->stream_map.size;
+
+    // Finish the character the last buffer cut, then hold back the one
+    // this buffer cuts
+    if (src->stream_carry_len > 0) {
+      src->stream_joined = g_malloc (src->stream_carry_len + len);
+      memcpy (src->stream_joined, src->stream_carry, src->stream_carry_len);
+      memcpy (src->stream_joined + src->stream_carry_len, text, len);
+      text = src->stream_joined;
+      len += src->stream_carry_len;
+    }
+    cut = morse_utf8_cut (text, len);
+    memcpy (src->stream_carry, text + len - cut, cut);
+    src->stream_carry_len = cut;
+
+    morse_code_feed (src->generated_morse, text, len - cut);
+  } else if (eos) {
+    // A character still cut at the end is invalid, like in a text
+    src->stream_carry_len = 0;
+    morse_code_close (src->generated_morse);
+  }
+
+  return TRUE;
+}
+
+static GstPad *
+gst_morse_src_request_new_pad (GstElement *element, GstPadTemplate *templ,
+    const gchar *name, const GstCaps *caps)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (element);
+  GstPad *pad;
+
+  GST_OBJECT_LOCK (src);
+  if (src->stream_pad) {
+    GST_OBJECT_UNLOCK (src);
+    GST_WARNING_OBJECT (src, "only one sink pad can be requested");
+    return NULL;
+  }
+  GST_OBJECT_UNLOCK (src);
+
+  pad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (pad,
+      GST_DEBUG_FUNCPTR (gst_morse_src_sink_chain));
+  gst_pad_set_event_function (pad,
+      GST_DEBUG_FUNCPTR (gst_morse_src_sink_event));
+
+  GST_OBJECT_LOCK (src);
+  src->stream_pad = pad;
+  GST_OBJECT_UNLOCK (src);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+gst_morse_src_release_pad (GstElement *element, GstPad *pad)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (element);
+
+  GST_OBJECT_LOCK (src);
+  if (pad == src->stream_pad)
+    src->stream_pad = NULL;
+  GST_OBJECT_UNLOCK (src);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+// Wake a create() waiting for text on the sink pad
+static gboolean
+gst_morse_src_unlock (GstBaseSrc *bsrc)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
+
+  g_mutex_lock (&src->stream_lock);
+  src->streaming = FALSE;
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_morse_src_unlock_stop (GstBaseSrc *bsrc)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
+
+  // Buffers rendered ahead are still due, a seek drops them in do_seek
+  if (src->pooled)
+    gst_morse_src_pool_settle (src);
+
+  g_mutex_lock (&src->stream_lock);
+  src->streaming = TRUE;
+  g_mutex_unlock (&src->stream_lock);
+
+  return TRUE;
+}
+
+// A GAP buffer of `num_samples` sharing the silence block, which is only
+// filled when the caps change or a longer stretch comes along
+static GstBuffer *
+gst_morse_src_gap_buffer (GstMorseSrc *src, guint num_samples)
+{
+  gsize size = (gsize) num_samples * GST_AUDIO_INFO_BPF (&src->info);
+  GstBuffer *buf = gst_buffer_new ();
+
+  if (!src->silence || gst_memory_get_sizes (src->silence, NULL, NULL) < size) {
+    gsize block = (gsize) src->block_samples * GST_AUDIO_INFO_BPF (&src->info);
+    GstMapInfo map;
+
+    if (src->silence)
+      gst_memory_unref (src->silence);
+    src->silence = gst_allocator_alloc (NULL, MAX (size, block), NULL);
+    gst_memory_map (src->silence, &map, GST_MAP_WRITE);
+    gst_audio_format_info_fill_silence (src->info.finfo, map.data, map.size);
+    gst_memory_unmap (src->silence, &map);
+    MORSE_STAT_ADD (src, allocations, 1);
+  }
+
+  if (size > 0)
+    gst_buffer_append_memory (buf, gst_memory_share (src->silence, 0, size));
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
+
+  return buf;
+}
+
+// Push `num_samples` of silence to keep the pipeline flowing
+static GstFlowReturn
+gst_morse_src_create_silence (GstMorseSrc *src, guint num_samples,
+  GstBuffer **buffer)
+{
+  size_t bpf = GST_AUDIO_INFO_BPF(&src->info);
+  GstBuffer *buf;
+  GstMapInfo map;
+  GstFlowReturn ret;
+
+  // Silence between messages ends an element cut short
+  if (src->keyed) {
+    gst_morse_src_post_keying (src, FALSE, src->sample_offset);
+    src->keyed = FALSE;
+  }
+
+  if (!src->render_audio || (src->noise_sigma <= 0.0 &&
+          src->gap_mode != GST_MORSE_GAP_MODE_NONE)) {
+    *buffer = gst_morse_src_gap_buffer (src, num_samples);
+    gst_morse_src_stamp_buffer (src, *buffer, num_samples);
+    return GST_FLOW_OK;
+  }
+
+  ret = gst_morse_src_alloc_buffer (src, num_samples * bpf, &buf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  if (src->noise_sigma > 0.0 && src->cwfunc &&
+      (!src->packfunc || num_samples <= src->scratch_samples)) {
+    // Noise only, packed formats go through the scratch area
+    guint8 *out = src->packfunc ? src->scratch : map.data;
+
+    src->mute = TRUE;
+    gst_morse_src_glide_to (src, 0);
+    src->cwfunc (src, out, 0, num_samples, num_samples);
+    src->mute = FALSE;
+    if (out != map.data)
+      src->packfunc (src->info.finfo, 0, src->scratch, map.data,
+          num_samples * GST_AUDIO_INFO_CHANNELS (&src->info));
+  } else {
+    gst_audio_format_info_fill_silence (src->info.finfo, map.data,
+        num_samples * bpf);
+  }
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_set_size (buf, num_samples * bpf);
+
+  gst_morse_src_stamp_buffer (src, buf, num_samples);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
+// Block until a text or voice set is queued or the streaming thread is
+// unlocked. Returns FALSE for the latter.
+static gboolean
+gst_morse_src_wait_text (GstMorseSrc *src)
+{
+  gboolean streaming;
+
+  g_mutex_lock (&src->stream_lock);
+  g_atomic_int_set (&src->text_waiting, TRUE);
+  while (src->streaming && !src->voices_changed &&
+      gst_morse_src_queue_empty (src))
+    g_cond_wait (&src->stream_cond, &src->stream_lock);
+  g_atomic_int_set (&src->text_waiting, FALSE);
+  streaming = src->streaming;
+  g_mutex_unlock (&src->stream_lock);
+
+  return streaming;
+}
+
+// Everything is played. One-shot elements post their completion and then
+// go back to READY, send EOS or wait for the next text, others EOS.
+static GstFlowReturn
+gst_morse_src_finish (GstMorseSrc *src, GstBuffer **buffer)
+{
+  gboolean first = !src->playback_complete;
+
+  if (!src->one_shot)
+    return GST_FLOW_EOS;
+
+  if (first) {
+    src->playback_complete = TRUE;
+    gst_morse_src_post_playback_complete (src);
+  }
+
+  switch (src->one_shot_mode) {
+    case GST_MORSE_ONE_SHOT_MODE_EOS:
+      return GST_FLOW_EOS;
+    case GST_MORSE_ONE_SHOT_MODE_WAIT:
+      if (!gst_morse_src_wait_text (src))
+        return GST_FLOW_FLUSHING;
+      src->rearmed = TRUE;
+      return gst_morse_src_produce (src, buffer);
+    case GST_MORSE_ONE_SHOT_MODE_READY:
+    default:
+      if (!first)
+        return GST_FLOW_EOS;
+      gst_element_call_async (GST_ELEMENT (src), gst_morse_src_async_ready,
+          NULL, NULL);
+      return GST_FLOW_FLUSHING;
+  }
+}
+
+// Take over the voice set last given to set_property
+static void
+gst_morse_src_update_voices (GstMorseSrc *src)
+{
+  GPtrArray *old;
+
+  gst_morse_src_lock (src);
+  old = src->voices;
+  src->voices = src->pending_voices;
+  src->pending_voices = NULL;
+  src->voices_changed = FALSE;
+  g_mutex_unlock (&src->lock);
+
+  if (old)
+    g_ptr_array_unref (old);
+}
+
+// Resolve what the voice leaves to the element and derive its dot grid,
+// tone and channel gains for the negotiated rate and channel count
+static void
+gst_morse_src_prepare_voice (GstMorseSrc *src, MorseVoice *voice)
+{
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+  gint channels = GST_AUDIO_INFO_CHANNELS (&src->info);
+  gdouble frequency = voice->frequency > 0 ? voice->frequency : src->frequency;
+  gint wpm = voice->wpm > 0 ? voice->wpm : src->wpm;
+  guint min_dot = src->high_speed ? MIN_HSCW_DOT_SAMPLES : MIN_DOT_SAMPLES;
+  MorseGrid grid;
+
+  if (!voice->code)
+    morse_voice_rewind (voice);
+
+  voice->dot_num = 6 * (guint64) rate;
+  voice->dot_den = 5 * (guint64) wpm;
+  voice->samples_per_dot = voice->dot_num / voice->dot_den;
+  if (voice->samples_per_dot < min_dot) {
+    voice->samples_per_dot = min_dot;
+    voice->dot_num = min_dot;
+    voice->dot_den = 1;
+  }
+  voice->phase_increment = 2.0 * G_PI * frequency / rate;
+  voice->gain = voice->volume >= 0 ? voice->volume : src->volume;
+
+  g_free (voice->gains);
+  voice->gains = g_new0 (gdouble, channels);
+  if (voice->channel >= channels)
+    GST_WARNING_OBJECT (src, "voice channel %d not in the %d output channels, "
+        "playing on all of them", voice->channel, channels);
+
+  if (voice->channel >= 0 && voice->channel < channels) {
+    voice->gains[voice->channel] = 1.0;
+  } else if (voice->panned && channels >= 2) {
+    // Constant power pan between the first two channels
+    gdouble angle = (voice->pan + 1.0) * G_PI / 4.0;
+
+    voice->gains[0] = cos (angle);
+    voice->gains[1] = sin (angle);
+  } else {
+    for (gint j = 0; j < channels; j++)
+      voice->gains[j] = 1.0;
+  }
+
+  voice->rate = rate;
+  voice->channels = channels;
+
+  grid = morse_voice_grid (voice);
+  gst_morse_src_prepare_ramps (src, rate, &grid);
+}
+
+// Add up to `count` samples of the voice to the interleaved mix. Returns
+// the samples it covered, fewer than `count` once its text has ended.
+static guint
+gst_morse_src_mix_voice (GstMorseSrc *src, MorseVoice *voice, gdouble *mix,
+    guint count)
+{
+  gint channels = voice->channels;
+  guint i = 0;
+
+  while (i < count) {
+    MorseCode *code = voice->code;
+    guint8 run;
+    guint len, num_samples, todo = 0;
+
+    if (voice->position >= code->n_runs) {
+      if (!voice->repeat) {
+        voice->finished = TRUE;
+        break;
+      }
+      morse_voice_rewind (voice);
+      continue;
+    }
+
+    run = code->runs[voice->position];
+    len = MORSE_RUN_LENGTH (run);
+
+    // Same timing as the single message: keyed runs are whole dots, gaps
+    // end on the exact dot grid
+    if (MORSE_RUN_IS_KEY (run)) {
+      num_samples = len * voice->samples_per_dot;
+    } else {
+      guint64 end = gst_util_uint64_scale (code->played + len,
+          voice->dot_num, voice->dot_den);
+      num_samples = end > voice->text_samples ? end - voice->text_samples : 0;
+    }
+
+    if (voice->symbol_offset < num_samples)
+      todo = MIN (count - i, num_samples - voice->symbol_offset);
+
+    if (MORSE_RUN_IS_KEY (run)) {
+      gint fade = gst_morse_src_fade_samples (src, voice->rate,
+          num_samples);
+
+      for (guint off = 0; off < todo; off += MORSE_TONE_BLOCK) {
+        gint n = MIN (MORSE_TONE_BLOCK, todo - off);
+        gdouble *dst = mix + (gsize) (i + off) * channels;
+
+        morse_fill_tone (src->oscillator, &voice->phase,
+            voice->phase_increment, src->tone, n);
+        gst_morse_src_shape_tone (src, src->tone, n,
+            voice->symbol_offset + off, num_samples, fade, voice->gain);
+
+        for (gint k = 0; k < n; k++)
+          for (gint j = 0; j < channels; j++)
+            dst[k * channels + j] += voice->gains[j] * src->tone[k];
+      }
+    }
+
+    i += todo;
+    voice->symbol_offset += todo;
+
+    if (voice->symbol_offset >= num_samples) {
+      voice->symbol_offset = 0;
+      voice->text_samples += num_samples;
+      morse_code_advance (code, &voice->position);
+    }
+  }
+
+  return i;
+}
+
+// Render every voice into one interleaved buffer. The voices are summed in
+// doubles and converted once, packed formats go through the scratch area.
+static GstFlowReturn
+gst_morse_src_create_voices (GstMorseSrc *src, GstBuffer **buffer)
+{
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+  gint channels = GST_AUDIO_INFO_CHANNELS (&src->info);
+  guint max_samples = gst_morse_src_update_block (src);
+  guint samples = 0;
+  gboolean active = FALSE;
+  GstClockTime t0;
+  GstBuffer *buf;
+  GstMapInfo map;
+  GstFlowReturn ret;
+
+  if (max_samples > src->mix_samples) {
+    g_free (src->mix);
+    src->mix = g_new (gdouble, (gsize) max_samples * channels);
+    src->mix_samples = max_samples;
+    MORSE_STAT_ADD (src, allocations, 1);
+  }
+  memset (src->mix, 0, (gsize) max_samples * channels * sizeof (gdouble));
+
+  t0 = gst_util_get_timestamp ();
+  for (guint v = 0; v < src->voices->len; v++) {
+    MorseVoice *voice = g_ptr_array_index (src->voices, v);
+
+    if (voice->finished)
+      continue;
+    if (voice->rate != rate || voice->channels != channels)
+      gst_morse_src_prepare_voice (src, voice);
+
+    samples = MAX (samples,
+        gst_morse_src_mix_voice (src, voice, src->mix, max_samples));
+    active |= !voice->finished;
+  }
+  if (src->noise_sigma > 0.0)
+    morse_channel_noise (&src->channel, src->mix,
+        max_samples * channels, src->noise_sigma);
+  MORSE_STAT_ADD (src, generate_time, gst_util_get_timestamp () - t0);
+
+  // The last buffer ends with the longest of the voices
+  if (active)
+    samples = max_samples;
+  else if (samples == 0)
+    return gst_morse_src_finish (src, buffer);
+
+  ret = gst_morse_src_alloc_buffer (src,
+      max_samples * GST_AUDIO_INFO_BPF (&src->info), &buf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  t0 = gst_util_get_timestamp ();
+  if (src->packfunc) {
+    src->mixfunc (src->scratch, src->mix, samples * channels);
+    src->packfunc (src->info.finfo, 0, src->scratch, map.data,
+        samples * channels);
+  } else {
+    src->mixfunc (map.data, src->mix, samples * channels);
+  }
+  MORSE_STAT_ADD (src, pack_time, gst_util_get_timestamp () - t0);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_set_size (buf, samples * GST_AUDIO_INFO_BPF (&src->info));
+
+  gst_morse_src_stamp_buffer (src, buf, samples);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
+// Sync the controlled properties to the start of the next buffer and
+// work out the slope of volume and frequency across it, with the channel
+// simulation's fading and drift on top. Properties set from other threads
+// are only picked up here as well.
+static void
+gst_morse_src_sync_controls (GstMorseSrc *src)
+{
+  GstObject *object = GST_OBJECT (src);
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+  GstSegment *segment = &GST_BASE_SRC (src)->segment;
+  gdouble volume_end = src->volume, frequency_end = src->frequency;
+  gdouble fade = 1.0, fade_end = 1.0, turn = 0.0, turn_end = 0.0;
+  GstClockTime start, end;
+  guint block;
+  GValue *value;
+
+  src->controlled = rate > 0 && gst_object_has_active_control_bindings (object);
+  src->simulating = rate > 0 && (src->noise ||
+      src->fading != GST_MORSE_FADING_NONE || src->chirp > 0.0 ||
+      src->drift > 0.0);
+
+  if (rate <= 0) {
+    src->volume_slope = 0.0;
+    src->increment_slope = 0.0;
+    src->control_volume = src->volume;
+    src->control_increment = 0.0;
+    gst_morse_src_glide_to (src, 0);
+    return;
+  }
+
+  block = gst_morse_src_update_block (src);
+
+  if (src->controlled) {
+    start = gst_segment_to_stream_time (segment, GST_FORMAT_TIME,
+        gst_morse_src_sample_time (src, src->sample_offset));
+    end = gst_segment_to_stream_time (segment, GST_FORMAT_TIME,
+        gst_morse_src_sample_time (src, src->sample_offset + block));
+
+    if (GST_CLOCK_TIME_IS_VALID (start))
+      gst_object_sync_values (object, start);
+    volume_end = src->volume;
+    frequency_end = src->frequency;
+
+    if (GST_CLOCK_TIME_IS_VALID (end) &&
+        (value = gst_object_get_value (object, "volume", end))) {
+      volume_end = CLAMP (g_value_get_double (value), MIN_VOLUME, MAX_VOLUME);
+      g_value_unset (value);
+      g_free (value);
+    }
+    if (GST_CLOCK_TIME_IS_VALID (end) &&
+        (value = gst_object_get_value (object, "frequency", end))) {
+      frequency_end = CLAMP (g_value_get_double (value), MIN_FREQUENCY,
+          MAX_FREQUENCY);
+      g_value_unset (value);
+      g_free (value);
+    }
+  }
+
+  // Fading scales the volume and turns the phase, drift moves the
+  // frequency, both planned from the samples played since the last buffer
+  if (src->simulating) {
+    MorseChannelParams params = { src->fading, src->fading_rate, src->drift };
+    MorseChannel *channel = &src->channel;
+
+    morse_channel_step (channel, &params, rate,
+        src->sample_offset > src->channel_offset
+        ? src->sample_offset - src->channel_offset : 0, block);
+    src->channel_offset = src->sample_offset;
+
+    fade = channel->fade;
+    fade_end = channel->fade + channel->fade_slope * block;
+    turn = channel->turn + 2.0 * G_PI * channel->drift / rate;
+    turn_end = channel->turn + 2.0 * G_PI *
+        (channel->drift + channel->drift_slope * block) / rate;
+  }
+
+  // Noise power in MORSE_NOISE_BANDWIDTH against the tone's power, spread
+  // over the whole band
+  src->noise_sigma = src->simulating && src->noise
+      ? src->volume / G_SQRT2 * pow (10.0, -src->snr / 20.0) *
+        sqrt (rate / (2.0 * MORSE_NOISE_BANDWIDTH))
+      : 0.0;
+
+  src->control_volume = src->volume * fade;
+  src->volume_slope = (volume_end * fade_end - src->control_volume) / block;
+  src->control_increment = 2.0 * G_PI * src->frequency / rate + turn;
+  src->increment_slope = (2.0 * G_PI * frequency_end / rate + turn_end -
+      src->control_increment) / block;
+  gst_morse_src_glide_to (src, 0);
+}
+
+// Live streams start at the current running time of the pipeline
+static void
+gst_morse_src_live_start (GstMorseSrc *src)
+{
+  if (src->is_live && !src->live_started) {
+    GstClockTime now = gst_element_get_current_running_time (GST_ELEMENT (src));
+    if (GST_CLOCK_TIME_IS_VALID (now))
+      src->time_base = now;
+    src->sample_offset = 0;
+    src->live_started = TRUE;
+  }
+}
+
+static GstFlowReturn
+gst_morse_src_produce (GstMorseSrc *src, GstBuffer **buffer)
+{
+  gst_morse_src_sync_controls (src);
+  gst_morse_src_live_start (src);
+
+  // A new voice set takes over at the buffer boundary and replaces the
+  // single message while it is set
+  if (src->voices_changed)
+    gst_morse_src_update_voices (src);
+  gst_morse_src_envelope_reset (src);
+  if (src->voices)
+    return gst_morse_src_create_voices (src, buffer);
+  
+  // Check for new text, a split element is finished first
+  if (gst_morse_src_text_ready (src)) {
+    gboolean chained = gst_morse_src_update_text (src);
+
+    if (!src->generated_morse || src->generated_morse->n_runs == 0) {
+      return GST_FLOW_EOS;
+    }
+    
+    // Create a small silent buffer to maintain pipeline flow, a chained
+    // message just goes on
+    if (!chained)
+      return gst_morse_src_create_silence (src, MIN (src->samples_per_dot,
+              gst_morse_src_update_block (src)), buffer);
+  }
+
+  // Text from the sink pad is encoded as it arrives
+  while (src->stream_pad && src->generated_morse &&
+      morse_code_starved (src->generated_morse, src->position)) {
+    if (!gst_morse_src_stream_feed (src))
+      return GST_FLOW_FLUSHING;
+    if (src->is_live && morse_code_starved (src->generated_morse,
+            src->position))
+      return gst_morse_src_create_silence (src,
+          gst_morse_src_update_block (src), buffer);
+  }
+
+  if (!src->generated_morse || src->position >= src->generated_morse->n_runs) {
+    // A live queue idles until the next message arrives, so does a
+    // waiting one-shot element once its completion is posted
+    if (src->is_live && src->one_shot &&
+        src->one_shot_mode == GST_MORSE_ONE_SHOT_MODE_WAIT &&
+        src->generated_morse && !src->playback_complete) {
+      src->playback_complete = TRUE;
+      gst_morse_src_post_playback_complete (src);
+    }
+    if (src->is_live && (src->queue_mode == GST_MORSE_QUEUE_MODE_APPEND ||
+            (src->one_shot &&
+                src->one_shot_mode == GST_MORSE_ONE_SHOT_MODE_WAIT)))
+      return gst_morse_src_create_silence (src,
+          gst_morse_src_update_block (src), buffer);
+
+    return gst_morse_src_finish (src, buffer);
+  }
+
+  // A WPM change applies from the run being played
+  if (g_atomic_int_get (&src->timing_dirty) &&
+      GST_AUDIO_INFO_RATE (&src->info) > 0)
+    gst_morse_src_update_timing (src, GST_AUDIO_INFO_RATE (&src->info));
+
+  // A faster speed can leave the offset past the new element length. That
+  // element is over, and the buffer starts over from the next one, so gap
+  // mode picks tone or silence for the run it really begins with.
+  if (src->symbol_offset > 0) {
+    guint num_samples = gst_morse_src_run_samples (src,
+        src->generated_morse->runs[src->position]);
+
+    if (src->symbol_offset >= num_samples) {
+      src->symbol_offset = 0;
+      src->text_samples += num_samples;
+      morse_code_advance (src->generated_morse, &src->position);
+      return gst_morse_src_produce (src, buffer);
+    }
+  }
+
+  // Cached symbols are already in the output format and need no packing.
+  // Controlled volume and frequency change from one element to the next.
+  gboolean cached = src->symbol_cache && src->render_audio &&
+      !src->high_speed && !src->controlled && !src->simulating;
+  if (cached && (src->cache_dirty || !src->cache))
+    gst_morse_src_build_cache (src);
+
+  // Parameter changes mid message leave the shared audio behind, a
+  // message starting from its first sample looks itself up
+  if ((src->shared_memory || src->shared_recording) &&
+      gst_morse_src_shared_stale (src))
+    gst_morse_src_shared_reset (src);
+  if (src->shared_cache && src->render_audio && !src->controlled &&
+      !src->simulating && !src->chained && !src->shared_memory &&
+      !src->shared_recording &&
+      src->generated_morse->indexable && src->position == 0 &&
+      src->symbol_offset == 0 && src->text_samples == 0)
+    gst_morse_src_shared_begin (src);
+
+  guint max_samples = gst_morse_src_update_block (src);
+  guint64 remaining = gst_morse_src_remaining_samples (src);
+  guint64 warning = gst_util_uint64_scale (src->about_to_finish_time,
+      GST_AUDIO_INFO_RATE (&src->info), GST_SECOND);
+
+  // End the buffer where the warning is due, so it is posted that long
+  // before the end to the sample
+  if (!src->about_to_finish_posted && remaining != G_MAXUINT64 &&
+      remaining > warning && remaining - warning < max_samples)
+    max_samples = remaining - warning;
+
+  // Formats needing packfunc are generated into the scratch area first
+  gboolean packed = src->packfunc && !cached;
+  size_t bpf = packed
+    ? src->packsize * GST_AUDIO_INFO_CHANNELS (&src->info)
+    : (size_t) GST_AUDIO_INFO_BPF (&src->info);
+
+  // A shared message only needs its runs walked, the audio exists already
+  gboolean shared = src->shared_memory != NULL;
+
+  // So does silence in gap mode, unless it is being recorded or carries
+  // noise, and everything when no audio is wanted
+  gboolean noisy = src->noise_sigma > 0.0;
+  gboolean split = src->gap_mode != GST_MORSE_GAP_MODE_NONE &&
+      src->render_audio && !noisy;
+  gboolean silent = !src->render_audio || (split && !src->shared_recording &&
+      !MORSE_RUN_IS_KEY (src->generated_morse->runs[src->position]));
+  gboolean keying = src->keying_messages || !src->render_audio;
+  guint64 shared_start = src->text_samples + src->symbol_offset;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  guint8 *out = NULL;
+
+  if (!shared && !silent) {
+    GstFlowReturn ret = gst_morse_src_alloc_buffer (src,
+        max_samples * GST_AUDIO_INFO_BPF (&src->info), &buf);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    out = packed ? src->scratch : map.data;
+  }
+
+  guint i = 0;
+  gint first_tone = -1;
+
+  // Timed over the whole walk, elements can be a few samples long and a
+  // clock read per element would cost more than generating it
+  GstClockTime generate_time = gst_util_get_timestamp ();
+
+  while (i < max_samples && src->position < src->generated_morse->n_runs)
+    {
+      guint8 run = src->generated_morse->runs[src->position];
+      gboolean key = MORSE_RUN_IS_KEY (run);
+      guint num_samples = gst_morse_src_run_samples (src, run);
+      guint todo = 0;
+
+      // Gap mode keeps tone and silence in separate buffers
+      if (split && i > 0 && key == silent)
+        break;
+
+      if (keying && key != src->keyed) {
+        gst_morse_src_post_keying (src, key, src->sample_offset + i);
+        src->keyed = key;
+      }
+
+      // Continue an element split at the end of the previous buffer. A
+      // WPM change mid-element can leave the offset past the new length.
+      if (src->symbol_offset < num_samples)
+        todo = MIN (max_samples - i, num_samples - src->symbol_offset);
+
+      if (shared || silent)
+        {
+          // Sliced from the shared message or the silence block below
+        }
+      else if (cached && key)
+        {
+          // Keyed runs are always a dit or a dah
+          const guint8 *block = MORSE_RUN_LENGTH (run) == 1
+            ? src->cache_dot : src->cache_dash;
+          memcpy (out + i * bpf, block + src->symbol_offset * bpf, todo * bpf);
+        }
+      else if (cached)
+        {
+          // Output is in the final format, which may be unsigned
+          gst_audio_format_info_fill_silence (src->info.finfo,
+              out + i * bpf, todo * bpf);
+        }
+      else if (key)
+        {
+          gst_morse_src_glide_to (src, i);
+          src->cwfunc (src, out + i * bpf, src->symbol_offset, todo,
+              num_samples);
+        }
+      else if (noisy)
+        {
+          // Gaps carry the channel noise
+          src->mute = TRUE;
+          gst_morse_src_glide_to (src, i);
+          src->cwfunc (src, out + i * bpf, src->symbol_offset, todo,
+              num_samples);
+          src->mute = FALSE;
+        }
+      else
+        {
+          // Zero is silence for every format the generators write
+          memset (out + i * bpf, 0, todo * bpf);
+        }
+
+      if (key && first_tone < 0)
+        first_tone = i;
+      
+      i += todo;
+      src->symbol_offset += todo;
+
+      if (src->symbol_offset >= num_samples)
+        {
+          src->symbol_offset = 0;
+          src->text_samples += num_samples;
+          morse_code_advance (src->generated_morse, &src->position);
+
+          // Cut the buffer here so a new text starts at this boundary. A
+          // chained one is spliced in and the buffer goes on, unless the
+          // buffer is a slice or recording of the shared message.
+          if (gst_morse_src_text_ready (src)) {
+            if (src->gapless && !shared && !src->shared_recording) {
+              gst_morse_src_update_text (src);
+              continue;
+            }
+            if (src->queue_mode == GST_MORSE_QUEUE_MODE_REPLACE)
+              break;
+          }
+        }
+    }
+  generate_time = gst_util_get_timestamp () - generate_time;
+
+  // Warn about-to-finish-time before the end, as soon as the end is known
+  remaining = gst_morse_src_remaining_samples (src);
+  if (!src->about_to_finish_posted && remaining <= warning) {
+    gst_morse_src_post_about_to_finish (src, gst_util_uint64_scale_int (
+            remaining, GST_SECOND, GST_AUDIO_INFO_RATE (&src->info)));
+    src->about_to_finish_posted = TRUE;
+  }
+
+  if (silent) {
+    buf = gst_morse_src_gap_buffer (src, i);
+  } else if (shared) {
+    gsize out_bpf = GST_AUDIO_INFO_BPF (&src->info);
+    gsize available = gst_memory_get_sizes (src->shared_memory, NULL, NULL);
+
+    // Zero-copy slice of the shared message
+    if ((shared_start + i) * out_bpf > available) {
+      GST_WARNING_OBJECT (src, "shared message shorter than its runs");
+      gst_morse_src_shared_reset (src);
+      return gst_morse_src_create_silence (src, MAX (i, 1), buffer);
+    }
+    buf = gst_buffer_new ();
+    if (i > 0)
+      gst_buffer_append_memory (buf, gst_memory_share (src->shared_memory,
+              shared_start * out_bpf, i * out_bpf));
+  } else {
+    if (packed) {
+      GstClockTime t0 = gst_util_get_timestamp ();
+
+      src->packfunc (src->info.finfo, 0, src->scratch, map.data,
+          i * GST_AUDIO_INFO_CHANNELS (&src->info));
+      MORSE_STAT_ADD (src, pack_time, gst_util_get_timestamp () - t0);
+    }
+    MORSE_STAT_ADD (src, generate_time, generate_time);
+
+    // Recordings too large for the budget are given up
+    if (src->shared_recording) {
+      g_byte_array_append (src->shared_recording, map.data,
+          i * GST_AUDIO_INFO_BPF (&src->info));
+      if (src->shared_recording->len > morse_shared_budget)
+        gst_morse_src_shared_reset (src);
+    }
+
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_set_size (buf, i * GST_AUDIO_INFO_BPF (&src->info));
+  }
+  
+  // Measure from set_property("text") to the first keyed sample
+  if (first_tone >= 0 && GST_CLOCK_TIME_IS_VALID (src->text_set_time)) {
+    GstClockTime audible =
+        gst_morse_src_sample_time (src, src->sample_offset + first_tone);
+    if (audible >= src->text_set_time) {
+      MORSE_STAT_SET (src, text_latency, audible - src->text_set_time);
+      GST_INFO_OBJECT (src, "text audible %" GST_TIME_FORMAT " after it was set",
+          GST_TIME_ARGS (audible - src->text_set_time));
+    }
+    src->text_set_time = GST_CLOCK_TIME_NONE;
+  }
+
+  gst_morse_src_stamp_buffer (src, buf, i);
+  *buffer = buf;
+
+  // A fully recorded message goes to the shared cache
+  if (src->shared_recording && src->generated_morse->done &&
+      src->position >= src->generated_morse->n_runs)
+    gst_morse_src_shared_store (src);
+
+  return GST_FLOW_OK;
+}
+
+// Stop replaying, recording and encoding, what the encoder holds is dropped
+static void
+gst_morse_src_encoded_reset (GstMorseSrc *src)
+{
+  GstBuffer *packet;
+
+  if (src->encoder) {
+    morse_encoder_end (src->encoder);
+    while ((packet = morse_encoder_pop (src->encoder)))
+      gst_buffer_unref (packet);
+  }
+  g_queue_clear_full (&src->encoded_pending, (GDestroyNotify) gst_buffer_unref);
+  if (src->encoded_replay)
+    gst_buffer_list_unref (src->encoded_replay);
+  src->encoded_replay = NULL;
+  if (src->encoded_recording)
+    gst_buffer_list_unref (src->encoded_recording);
+  src->encoded_recording = NULL;
+  g_free (src->encoded_key);
+  src->encoded_key = NULL;
+  src->encoded_flow = GST_FLOW_OK;
+}
+
+static void
+gst_morse_src_encoded_drop_recording (GstMorseSrc *src)
+{
+  if (src->encoded_recording)
+    gst_buffer_list_unref (src->encoded_recording);
+  src->encoded_recording = NULL;
+  g_free (src->encoded_key);
+  src->encoded_key = NULL;
+}
+
+static void
+morse_packet_rebase (GstBuffer *packet, GstClockTime base)
+{
+  if (GST_BUFFER_PTS_IS_VALID (packet))
+    GST_BUFFER_PTS (packet) += base;
+  if (GST_BUFFER_DTS_IS_VALID (packet))
+    GST_BUFFER_DTS (packet) += base;
+}
+
+// The stream headers are in the caps, they are pushed again when a packet
+// comes from an encoder set up differently
+static void
+gst_morse_src_encoded_caps (GstMorseSrc *src, GstCaps *caps)
+{
+  if (!caps || (src->encoded_caps && gst_caps_is_equal (caps,
+              src->encoded_caps)))
+    return;
+
+  gst_caps_replace (&src->encoded_caps, caps);
+  gst_pad_push_event (GST_BASE_SRC_PAD (src), gst_event_new_caps (caps));
+}
+
+// Move the encoder's packets to the output in stream time. A recording
+// keeps them as they are, relative to the start of the message.
+static void
+gst_morse_src_encoded_collect (GstMorseSrc *src)
+{
+  GstBuffer *packet;
+
+  while ((packet = morse_encoder_pop (src->encoder))) {
+    if (src->encoded_recording) {
+      GstBuffer *copy = gst_buffer_copy (packet);
+
+      gst_buffer_list_add (src->encoded_recording, packet);
+      packet = copy;
+    } else {
+      packet = gst_buffer_make_writable (packet);
+    }
+    morse_packet_rebase (packet, src->encoded_base);
+    g_queue_push_tail (&src->encoded_pending, packet);
+  }
+}
+
+// End the encoder session, its last packets go out before anything else
+static void
+gst_morse_src_encoded_close (GstMorseSrc *src)
+{
+  morse_encoder_end (src->encoder);
+  gst_morse_src_encoded_collect (src);
+}
+
+// The recorded message is complete, hand its packets to the shared cache
+// unless the parameters changed on the way or another element stored it
+static void
+gst_morse_src_encoded_store (GstMorseSrc *src)
+{
+  GstBufferList *packets = src->encoded_recording;
+  GstCaps *caps = morse_encoder_get_caps (src->encoder);
+  gsize size = gst_buffer_list_calculate_size (packets);
+
+  src->encoded_recording = NULL;
+
+  g_mutex_lock (&morse_shared_lock);
+  if (caps && size > 0 && size <= morse_shared_budget &&
+      !gst_morse_src_params_changed (src, &src->encoded_params) &&
+      !g_hash_table_contains (morse_shared_table, src->encoded_key)) {
+    MorseSharedEntry *entry = g_new0 (MorseSharedEntry, 1);
+
+    entry->key = src->encoded_key;
+    entry->size = size;
+    entry->packets = packets;
+    entry->caps = gst_caps_ref (caps);
+    entry->samples = src->encoded_recorded;
+    src->encoded_key = NULL;
+    packets = NULL;
+
+    morse_shared_insert (entry);
+    GST_DEBUG_OBJECT (src, "stored %" G_GSIZE_FORMAT " encoded bytes, cache "
+        "holds %" G_GUINT64_FORMAT, size, morse_shared_bytes);
+  }
+  g_mutex_unlock (&morse_shared_lock);
+
+  if (packets)
+    gst_buffer_list_unref (packets);
+  g_free (src->encoded_key);
+  src->encoded_key = NULL;
+}
+
+// The first sample of a whole message that plays the same every time
+static gboolean
+gst_morse_src_encoded_eligible (GstMorseSrc *src)
+{
+  MorseCode *code = src->generated_morse;
+
+  if (!gst_morse_src_encoded_per_message (src) ||
+      !code || !code->done || !code->indexable || code->n_runs == 0 ||
+      src->position != 0 || src->symbol_offset != 0 ||
+      src->text_samples != 0 || src->encoded_recording || src->chained ||
+      src->voices || src->voices_changed || gst_morse_src_text_ready (src))
+    return FALSE;
+
+  gst_morse_src_sync_controls (src);
+  return !src->controlled && !src->simulating;
+}
+
+// At the first sample of a message, replay its packets from the shared
+// cache or encode it in a session of its own and record them. Returns
+// TRUE for a replay.
+static gboolean
+gst_morse_src_encoded_begin (GstMorseSrc *src)
+{
+  gchar *raw_key = gst_morse_src_shared_key (src);
+  gchar *key = g_strdup_printf ("%s/%s", src->encoded_format, raw_key);
+  MorseSharedEntry *entry;
+  GstCaps *caps = NULL;
+
+  g_free (raw_key);
+  gst_morse_src_encoded_close (src);
+  gst_morse_src_live_start (src);
+
+  g_mutex_lock (&morse_shared_lock);
+  if ((entry = morse_shared_lookup (key)) && entry->packets) {
+    src->encoded_replay = gst_buffer_list_ref (entry->packets);
+    src->encoded_samples = entry->samples;
+    caps = gst_caps_ref (entry->caps);
+  }
+  g_mutex_unlock (&morse_shared_lock);
+
+  if (src->encoded_replay) {
+    GST_DEBUG_OBJECT (src, "replaying \"%s\" from the shared cache", src->text);
+    src->encoded_index = 0;
+    src->encoded_start = gst_morse_src_sample_time (src, src->sample_offset);
+    gst_morse_src_encoded_caps (src, caps);
+    gst_caps_unref (caps);
+    g_free (key);
+    return TRUE;
+  }
+
+  // Recordings start keying at phase zero, as replays do
+  gst_morse_src_render_params (src, &src->encoded_params);
+  src->encoded_key = key;
+  src->encoded_recording = gst_buffer_list_new ();
+  src->encoded_recorded = 0;
+  src->phase = 0.0;
+  return FALSE;
+}
+
+// Next packet of the message being replayed. After the last one the
+// message is played, as far as the rest of the element is concerned.
+static GstFlowReturn
+gst_morse_src_encoded_replay (GstMorseSrc *src, GstBuffer **buffer)
+{
+  GstBufferList *packets = src->encoded_replay;
+  GstBuffer *packet = gst_buffer_copy (gst_buffer_list_get (packets,
+          src->encoded_index++));
+  GstClockTime duration = gst_util_uint64_scale_int (src->encoded_samples,
+      GST_SECOND, GST_AUDIO_INFO_RATE (&src->info));
+  GstClockTime end = GST_BUFFER_PTS_IS_VALID (packet) ?
+      GST_BUFFER_PTS (packet) : 0;
+
+  if (GST_BUFFER_DURATION_IS_VALID (packet))
+    end += GST_BUFFER_DURATION (packet);
+  if (!src->about_to_finish_posted &&
+      end + src->about_to_finish_time >= duration) {
+    gst_morse_src_post_about_to_finish (src, duration > end ?
+        duration - end : 0);
+    src->about_to_finish_posted = TRUE;
+  }
+
+  morse_packet_rebase (packet, src->encoded_start);
+  if (src->encoded_index == gst_buffer_list_length (packets)) {
+    MorseCode *code = src->generated_morse;
+
+    gst_buffer_list_unref (src->encoded_replay);
+    src->encoded_replay = NULL;
+    src->sample_offset += src->encoded_samples;
+    src->text_samples = src->encoded_samples;
+    src->position = code->n_runs;
+    code->played = code->units;
+  }
+
+  *buffer = packet;
+  return GST_FLOW_OK;
+}
+
+// Encode a raw buffer in the open session, or open one at its timestamp
+static GstFlowReturn
+gst_morse_src_encoded_feed (GstMorseSrc *src, GstBuffer *raw)
+{
+  guint64 samples = gst_buffer_get_size (raw) / GST_AUDIO_INFO_BPF (&src->info);
+  GstFlowReturn ret;
+
+  if (!morse_encoder_is_open (src->encoder))
+    src->encoded_base = GST_BUFFER_PTS (raw);
+
+  // Silence is encoded like the rest, the packets carry no GAP flag
+  raw = gst_buffer_make_writable (raw);
+  GST_BUFFER_FLAG_UNSET (raw, GST_BUFFER_FLAG_GAP);
+  GST_BUFFER_PTS (raw) -= src->encoded_base;
+  GST_BUFFER_DTS (raw) = GST_CLOCK_TIME_NONE;
+
+  ret = morse_encoder_push (src->encoder, raw);
+  gst_morse_src_encoded_collect (src);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (src->encoded_recording) {
+    src->encoded_recorded += samples;
+    if (src->generated_morse &&
+        src->position >= src->generated_morse->n_runs) {
+      gst_morse_src_encoded_close (src);
+      gst_morse_src_encoded_store (src);
+    }
+  }
+  return GST_FLOW_OK;
+}
+
+// Encoded caps: raw buffers from gst_morse_src_produce go through the
+// encoder. A whole FLAC message is encoded once and replayed from the
+// shared cache after that, Opus is always encoded as it plays. One raw
+// buffer can give no packet or several.
+static GstFlowReturn
+gst_morse_src_produce_encoded (GstMorseSrc *src, GstBuffer **buffer)
+{
+  GstFlowReturn ret;
+  GstBuffer *raw;
+
+  for (;;) {
+    if ((*buffer = g_queue_pop_head (&src->encoded_pending))) {
+      gst_morse_src_encoded_caps (src, morse_encoder_get_caps (src->encoder));
+      return GST_FLOW_OK;
+    }
+    if (src->encoded_replay)
+      return gst_morse_src_encoded_replay (src, buffer);
+    if (src->encoded_flow != GST_FLOW_OK) {
+      ret = src->encoded_flow;
+      src->encoded_flow = GST_FLOW_OK;
+      return ret;
+    }
+
+    // A new FLAC message is encoded apart from the last, which may not be
+    // recorded when it is cut short
+    if (gst_morse_src_encoded_per_message (src) &&
+        gst_morse_src_text_ready (src) &&
+        (morse_encoder_is_open (src->encoder) || src->encoded_recording)) {
+      gst_morse_src_encoded_drop_recording (src);
+      gst_morse_src_encoded_close (src);
+      continue;
+    }
+
+    if (gst_morse_src_encoded_eligible (src) &&
+        gst_morse_src_encoded_begin (src))
+      continue;
+
+    ret = gst_morse_src_produce (src, &raw);
+    if (ret == GST_FLOW_OK)
+      ret = gst_morse_src_encoded_feed (src, raw);
+    if (ret != GST_FLOW_OK) {
+      // What the encoder holds goes out before the flow
+      gst_morse_src_encoded_drop_recording (src);
+      gst_morse_src_encoded_close (src);
+      src->encoded_flow = ret;
+    }
+  }
+}
+
+static GstFlowReturn
+gst_morse_src_next (GstMorseSrc *src, GstBuffer **buffer)
+{
+  if (src->encoder)
+    return gst_morse_src_produce_encoded (src, buffer);
+  if (src->pooled)
+    return gst_morse_src_pool_pop (src, buffer);
+  return gst_morse_src_produce (src, buffer);
+}
+
+static GstFlowReturn
+gst_morse_src_create (GstPushSrc *pushsrc, GstBuffer **buffer)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (pushsrc);
+  GstPad *pad = GST_BASE_SRC_PAD (src);
+  GstFlowReturn ret = gst_morse_src_next (src, buffer);
+  GstEvent *segment;
+  GstBuffer *gap;
+
+  if (ret != GST_FLOW_OK || src->encoder ||
+      src->gap_mode != GST_MORSE_GAP_MODE_EVENT ||
+      !GST_BUFFER_FLAG_IS_SET (*buffer, GST_BUFFER_FLAG_GAP))
+    return ret;
+
+  // Events need the segment downstream, the first buffer carries it
+  segment = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  if (!segment)
+    return ret;
+  gst_event_unref (segment);
+
+  // Event mode turns the silent buffer into a GAP event and hands out the
+  // buffer after it. Silence after silence stays a GAP buffer, so an idle
+  // live source still waits on the clock between buffers.
+  gap = *buffer;
+  *buffer = NULL;
+  gst_pad_push_event (pad, gst_event_new_gap (GST_BUFFER_PTS (gap),
+          GST_BUFFER_DURATION (gap)));
+  gst_buffer_unref (gap);
+
+  return gst_morse_src_next (src, buffer);
 }
 
-static void
-gst_morse_src_get_property (GObject *object, guint prop_id,
-                           GValue *value, GParamSpec *pspec)
+// Make sure the pool hands out buffers large enough for a full block, then
+// let GstBaseSrc configure it (creating an internal pool if downstream
+// offered none).
+static gboolean
+gst_morse_src_decide_allocation (GstBaseSrc *bsrc, GstQuery *query)
 {
-  GstMorseSrc *src = GST_MORSE_SRC (object);
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
+  GstBufferPool *pool = NULL;
+  guint size = 0, min = 0, max = 0;
+  guint block = gst_base_src_get_blocksize (bsrc);
 
-  switch (prop_id)
-    {
-    case PROP_FREQUENCY:
-      g_value_set_double (value, src->frequency);
-      break;
-    case PROP_VOLUME:
-      g_value_set_double (value, src->volume);
-      break;
-    case PROP_WPM:
-      g_value_set_int (value, src->wpm);
-      break;
-    case PROP_TEXT:
-      g_mutex_lock(&src->lock);
-      g_value_set_string (value, src->text);
-      g_mutex_unlock(&src->lock);
-      break;
-    case PROP_ONE_SHOT:
-      g_value_set_boolean (value, src->one_shot);
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-    }
+  if (gst_query_get_n_allocation_pools (query) > 0) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+    gst_query_set_nth_allocation_pool (query, 0, pool, MAX (size, block),
+        min, max);
+    if (pool)
+      gst_object_unref (pool);
+  } else {
+    gst_query_add_allocation_pool (query, NULL, block, 0, 0);
+  }
+
+  GST_DEBUG_OBJECT (src, "buffer pool sized for %u bytes", MAX (size, block));
+
+  return GST_BASE_SRC_CLASS (gst_morse_src_parent_class)->decide_allocation
+      (bsrc, query);
 }
 
+// Live buffers are pushed when the clock reaches their timestamp, as
+// audiotestsrc does, non-live ones as fast as downstream accepts them
 static void
-gst_morse_src_finalize (GObject * object)
+gst_morse_src_get_times (GstBaseSrc *bsrc, GstBuffer *buffer,
+    GstClockTime *start, GstClockTime *end)
 {
-  GstMorseSrc *src = GST_MORSE_SRC (object);
+  if (gst_base_src_is_live (bsrc)) {
+    GstClockTime timestamp = GST_BUFFER_PTS (buffer);
 
-  g_mutex_lock(&src->lock);
-  
-  if (src->pending_text) {
-    g_free(src->pending_text);
-    src->pending_text = NULL;
-  }
-  if (src->text) {
-    g_free(src->text);
-    src->text = NULL;
-  }
-  if (src->generated_morse) {
-    g_string_free(src->generated_morse, TRUE);
-    src->generated_morse = NULL;
+    if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
+      GstClockTime duration = GST_BUFFER_DURATION (buffer);
+
+      if (GST_CLOCK_TIME_IS_VALID (duration))
+        *end = timestamp + duration;
+      *start = timestamp;
+    }
+  } else {
+    *start = GST_CLOCK_TIME_NONE;
+    *end = GST_CLOCK_TIME_NONE;
   }
-  
-  g_mutex_unlock(&src->lock);
-  g_mutex_clear(&src->lock);
+}
 
-  G_OBJECT_CLASS (gst_morse_src_parent_class)->finalize (object);
+// Length of the current text at the current speed, GST_CLOCK_TIME_NONE
+// when it is streamed from the sink pad. Called with src->lock held, the
+// first call for a text walks it once to build its index.
+static GstClockTime
+gst_morse_src_get_duration (GstMorseSrc *src)
+{
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+  MorseIndex *index;
+
+  if (!src->generated_morse || src->voices || rate <= 0 || src->dot_den == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  if (!(index = morse_code_get_index (src->generated_morse)))
+    return GST_CLOCK_TIME_NONE;
+
+  return gst_util_uint64_scale (gst_util_uint64_scale (index->units,
+          src->dot_num, src->dot_den), GST_SECOND, rate);
 }
 
-static GstFlowReturn
-gst_morse_src_create (GstPushSrc *pushsrc, GstBuffer **buffer)
+static gboolean
+gst_morse_src_is_seekable (GstBaseSrc *bsrc)
 {
-  GstMorseSrc *src = GST_MORSE_SRC (pushsrc);
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
+  gboolean seekable;
 
-  // Check for new text
-  if (src->new_text_pending) {
-    gst_morse_src_update_text(src);
-    if (!src->generated_morse || src->generated_morse->len == 0) {
-      return GST_FLOW_EOS;
-    }
-    
-    // Create a small silent buffer to maintain pipeline flow
-    guint num_samples = src->samples_per_dot;
-    size_t bpf = GST_AUDIO_INFO_BPF(&src->info);
-    GstBuffer *buf = gst_buffer_new_and_alloc(num_samples * bpf);
-    gst_buffer_memset(buf, 0, 0, num_samples * bpf);
-    
-    GST_BUFFER_PTS(buf) = src->timestamp;
-    GST_BUFFER_DURATION(buf) = 
-      gst_util_uint64_scale(num_samples, GST_SECOND, GST_AUDIO_INFO_RATE(&src->info));
-    src->timestamp += GST_BUFFER_DURATION(buf);
-    *buffer = buf;
-    
-    return GST_FLOW_OK;
+  gst_morse_src_lock (src);
+  seekable = src->stream_pad == NULL && src->voices_desc == NULL;
+  g_mutex_unlock (&src->lock);
+
+  return seekable;
+}
+
+// Jump to segment->start: find the element it falls in, the samples of it
+// already played and the tone phase after every keyed sample before it
+static gboolean
+gst_morse_src_do_seek (GstBaseSrc *bsrc, GstSegment *segment)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
+  gint rate = GST_AUDIO_INFO_RATE (&src->info);
+  // Keyed runs as gst_morse_src_run_samples plays them
+  MorseGrid grid = gst_morse_src_grid (src);
+  guint64 sample = 0, unit = 0, run_unit, keyed;
+  guint position;
+  gboolean ret;
+
+  if (segment->format != GST_FORMAT_TIME)
+    return FALSE;
+
+  if (src->pooled)
+    gst_morse_src_pool_flush (src);
+  gst_morse_src_encoded_reset (src);
+
+  // Streamed text only ever plays forward
+  if (src->stream_pad)
+    return segment->start == 0;
+
+  if (rate > 0 && src->dot_den > 0) {
+    sample = gst_util_uint64_scale (segment->start, rate, GST_SECOND);
+    unit = gst_util_uint64_scale (sample, src->dot_den, src->dot_num);
+  } else if (segment->start > 0) {
+    return FALSE;
   }
 
-  if (!src->generated_morse || src->position >= src->generated_morse->len) {
-    if (src->one_shot && !src->playback_complete) {
-      src->playback_complete = TRUE;
-      
-      // Post completion message
-      gst_morse_src_post_playback_complete(src);
-      
-      // Schedule state change to READY in idle callback to avoid deadlock
-      g_idle_add(gst_morse_src_idle_state_change, g_object_ref(src));
-      
-      return GST_FLOW_FLUSHING;
+  gst_morse_src_lock (src);
+  ret = src->generated_morse &&
+      morse_code_seek (src->generated_morse, unit, &grid, &position,
+      &run_unit, &keyed);
+  if (ret) {
+    guint64 keyed_samples = keyed;
+
+    // Keep the dot grid of the text from unit 0, so the runs after the
+    // target end on the same samples as when played through
+    src->text_samples = src->dot_den > 0
+        ? gst_util_uint64_scale (run_unit, src->dot_num, src->dot_den) : 0;
+    src->unit_base = 0;
+    src->sample_base = 0;
+
+    src->position = position;
+    src->symbol_offset = 0;
+    if (position < src->generated_morse->n_runs) {
+      src->symbol_offset = sample - src->text_samples;
+      if (MORSE_RUN_IS_KEY (src->generated_morse->runs[position]))
+        keyed_samples += src->symbol_offset;
     }
-    return GST_FLOW_EOS;
+
+    src->phase = fmod (keyed_samples * src->phase_increment, 2.0 * G_PI);
+
+    // A shared message plays on from the new sample, a recording has a
+    // hole now
+    if (src->shared_recording)
+      gst_morse_src_shared_reset (src);
+    src->time_base = 0;
+    src->sample_offset = sample;
+    src->channel_offset = sample;
+    src->keyed = FALSE;
+    src->about_to_finish_posted = FALSE;
+    src->playback_complete = FALSE;
+    segment->position = segment->start;
+    segment->time = segment->start;
   }
+  g_mutex_unlock (&src->lock);
 
-  guint samples_per_dot = src->samples_per_dot;
-  guint samples_per_dash = src->samples_per_dot * 3;
-  guint samples_per_space = src->samples_per_dot;
-  guint max_samples = 5292*10;
+  GST_DEBUG_OBJECT (src, "seek to %" GST_TIME_FORMAT " run %u offset %u",
+      GST_TIME_ARGS (segment->start), src->position, src->symbol_offset);
 
-  size_t bpf = src->packfunc
-    ? src->packsize * GST_AUDIO_INFO_CHANNELS (&src->info)
-    : (size_t) GST_AUDIO_INFO_BPF (&src->info);
+  return ret;
+}
 
-  GstBuffer *buf = gst_buffer_new_and_alloc (max_samples * bpf);
-  GstMapInfo map;
-  gst_buffer_map (buf, &map, GST_MAP_WRITE);
-  gst_buffer_memset (buf, 0, 0, max_samples * bpf);
-  
-  guint i = 0;
+static gboolean
+gst_morse_src_query (GstBaseSrc *bsrc, GstQuery *query)
+{
+  GstMorseSrc *src = GST_MORSE_SRC (bsrc);
 
-  while (i < max_samples && src->position < src->generated_morse->len)
-    {
-      char symbol = src->generated_morse->str[src->position];
-      guint num_samples = 0;
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_DURATION:
+      {
+        GstFormat format;
+        GstClockTime duration;
 
-      switch (symbol) {
-      case '.':
-        num_samples = samples_per_dot;
-        break;
-      case '-':
-        num_samples = samples_per_dash;
-        break;
-      case ' ':
-        num_samples = samples_per_space;
-        break;
+        gst_query_parse_duration (query, &format, NULL);
+        if (format != GST_FORMAT_TIME)
+          break;
+
+        gst_morse_src_lock (src);
+        duration = gst_morse_src_get_duration (src);
+        g_mutex_unlock (&src->lock);
+
+        if (!GST_CLOCK_TIME_IS_VALID (duration))
+          break;
+
+        gst_query_set_duration (query, GST_FORMAT_TIME, duration);
+        return TRUE;
       }
+    case GST_QUERY_POSITION:
+      {
+        GstFormat format;
 
-      num_samples = MIN (max_samples - i, num_samples);
+        gst_query_parse_position (query, &format, NULL);
+        if (format != GST_FORMAT_TIME || src->is_live ||
+            GST_AUDIO_INFO_RATE (&src->info) <= 0)
+          break;
 
-      if (symbol != ' ')
-        {
-          src->cwfunc (src, map.data + i * bpf, num_samples);
-        }
-      
-      i += num_samples;
+        // Time of the next sample within the current text
+        gst_query_set_position (query, GST_FORMAT_TIME,
+            gst_morse_src_sample_time (src, src->sample_offset));
+        return TRUE;
+      }
+    case GST_QUERY_SEEKING:
+      {
+        GstFormat format;
+        GstClockTime duration = GST_CLOCK_TIME_NONE;
+        gboolean seekable = gst_morse_src_is_seekable (bsrc);
 
-      if (num_samples < samples_per_space
-          && samples_per_space < max_samples - i)
-        {
-          i += samples_per_space - num_samples;
+        gst_query_parse_seeking (query, &format, NULL, NULL, NULL);
+        if (format != GST_FORMAT_TIME)
+          break;
+
+        if (seekable) {
+          gst_morse_src_lock (src);
+          duration = gst_morse_src_get_duration (src);
+          g_mutex_unlock (&src->lock);
         }
-      
-      src->position++;
-    }
 
-  // Check if we're near the end (90% through the morse code)
-  if (src->generated_morse && 
-      src->position > (src->generated_morse->len * 0.9) &&
-      !src->about_to_finish_posted) {
-    gst_morse_src_post_about_to_finish (src);
-    src->about_to_finish_posted = TRUE;
-  }
+        gst_query_set_seeking (query, GST_FORMAT_TIME, seekable, 0,
+            GST_CLOCK_TIME_IS_VALID (duration) ? (gint64) duration : -1);
+        return TRUE;
+      }
+    case GST_QUERY_LATENCY:
+      {
+        gint rate = GST_AUDIO_INFO_RATE (&src->info);
+        gint bpf = GST_AUDIO_INFO_BPF (&src->info);
+        GstClockTime latency;
 
-  if (src->packfunc)
-    {
-      GstBuffer *rbuf = gst_buffer_new_and_alloc (
-        max_samples * GST_AUDIO_INFO_BPF (&src->info)
-      );
-
-      GstMapInfo rmap;
-      gst_buffer_map (rbuf, &rmap, GST_MAP_WRITE);
-      src->packfunc (src->info.finfo, 0, map.data, rmap.data, i);
-      gst_buffer_set_size (rbuf, GST_AUDIO_INFO_BPF (&src->info) * i);
-      gst_buffer_unmap (rbuf, &rmap);
-      gst_buffer_unref (buf);
-      buf = rbuf;
-    }
-  else
-    {
-      gst_buffer_unmap (buf, &map);
-      gst_buffer_set_size (buf, i * bpf);
-    }
-  
-  GST_BUFFER_PTS (buf) = src->timestamp;
-  GST_BUFFER_DURATION (buf) =
-    gst_util_uint64_scale (i, GST_SECOND, GST_AUDIO_INFO_RATE (&src->info));
-  src->timestamp += GST_BUFFER_DURATION (buf);
-  *buffer = buf;
+        if (rate <= 0 || bpf <= 0)
+          break;
 
-  return GST_FLOW_OK;
+        // A whole block is rendered before it is pushed, on the render
+        // pool render-ahead more of them
+        latency = gst_util_uint64_scale_int (
+            MAX (gst_base_src_get_blocksize (bsrc) / bpf, 1), GST_SECOND, rate);
+        if (src->pooled)
+          latency *= 1 + src->render_ahead;
+        gst_query_set_latency (query, gst_base_src_is_live (bsrc),
+            latency, latency);
+        GST_DEBUG_OBJECT (src, "reporting latency of %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (latency));
+        return TRUE;
+      }
+    default:
+      break;
+  }
+
+  return GST_BASE_SRC_CLASS (gst_morse_src_parent_class)->query (bsrc, query);
 }
 
 static GstCaps *
@@ -716,9 +4910,12 @@ gst_morse_src_fixate (GstBaseSrc *bsrc, GstCaps *caps)
   gst_structure_fixate_field_nearest_int (structure, "rate", GST_AUDIO_DEF_RATE);
   gst_structure_fixate_field_string (structure, "format", DEFAULT_FORMAT_STR);
   gst_structure_fixate_field_string (structure, "layout", "interleaved");
-  gst_structure_fixate_field_nearest_int (structure, "channels", 1);
+  // Panned or channel-routed voices ask for as many channels as they use
+  gst_structure_fixate_field_nearest_int (structure, "channels",
+      src->voices_channels);
 
-  if (gst_structure_get_int (structure, "channels", &channels) && channels > 2) {
+  if (gst_structure_has_name (structure, "audio/x-raw") &&
+      gst_structure_get_int (structure, "channels", &channels) && channels > 2) {
     if (!gst_structure_has_field_typed (structure, "channel-mask",
                                       GST_TYPE_BITMASK))
       gst_structure_set (structure, "channel-mask", GST_TYPE_BITMASK, 0ULL,
@@ -734,30 +4931,71 @@ static gboolean
 gst_morse_src_setcaps (GstBaseSrc *basesrc, GstCaps *caps)
 {
   GstMorseSrc *src = GST_MORSE_SRC (basesrc);
+  GstStructure *structure = gst_caps_get_structure (caps, 0);
   GstAudioInfo info;
 
-  if (!gst_audio_info_from_caps (&info, caps))
+  // A pool job renders with the format, generators and scratch area
+  // replaced below, and what it rendered ahead is in the old format
+  gst_morse_src_pool_flush (src);
+
+  // Encoded caps are rendered as S16 in their rate and channels and go
+  // through the encoder
+  gst_morse_src_encoded_reset (src);
+  gst_caps_replace (&src->encoded_caps, NULL);
+  if (src->encoder)
+    morse_encoder_free (src->encoder);
+  src->encoder = NULL;
+  src->encoded_format = NULL;
+  if (gst_structure_has_name (structure, "audio/x-opus"))
+    src->encoded_format = "opusenc";
+  else if (gst_structure_has_name (structure, "audio/x-flac"))
+    src->encoded_format = "flacenc";
+
+  if (src->encoded_format) {
+    gint rate = GST_AUDIO_DEF_RATE, channels = 1;
+    GstCaps *raw;
+
+    gst_structure_get_int (structure, "rate", &rate);
+    gst_structure_get_int (structure, "channels", &channels);
+    gst_audio_info_set_format (&info, GST_AUDIO_FORMAT_S16, rate, channels,
+        NULL);
+    raw = gst_audio_info_to_caps (&info);
+    src->encoder = morse_encoder_new (src->encoded_format, raw);
+    gst_caps_unref (raw);
+    if (!src->encoder) {
+      GST_ERROR_OBJECT (src, "%s is needed for %" GST_PTR_FORMAT,
+          src->encoded_format, (void *) caps);
+      return FALSE;
+    }
+
+    // Packets and their caps are pushed by the streaming thread
+    src->pooled = FALSE;
+  } else if (!gst_audio_info_from_caps (&info, caps)) {
     goto invalid_caps;
+  }
 
   GST_DEBUG_OBJECT (src, "negotiated to caps %" GST_PTR_FORMAT, (void *) caps);
   
-  // More precise timing calculation
-  gdouble dot_duration = 1.2 / src->wpm;
-  src->samples_per_dot = (guint)(dot_duration * GST_AUDIO_INFO_RATE(&info));
-  
-  // Ensure minimum samples to avoid clicks
-  if (src->samples_per_dot < 100) {
-    src->samples_per_dot = 100;
-    GST_WARNING_OBJECT(src, "Dot duration too short, using minimum");
-  }
-  
-  src->samples_per_dash = src->samples_per_dot * 3;
-  src->samples_per_space = src->samples_per_dot;
+  gst_morse_src_update_timing (src, GST_AUDIO_INFO_RATE (&info));
+
+  // Shared audio and the silence block are only valid in the caps they
+  // were rendered in
+  gst_morse_src_shared_reset (src);
+  if (src->silence)
+    gst_memory_unref (src->silence);
+  src->silence = NULL;
 
   src->cwfunc = NULL;
+  src->mixfunc = NULL;
   src->packfunc = NULL;
   src->packsize = 0;
 
+  src->kernels = gst_morse_kernels_get (src->simd);
+  if (!src->kernels && src->simd != GST_MORSE_SIMD_NONE)
+    GST_WARNING_OBJECT (src, "Requested kernels not supported, using scalar generators");
+  GST_DEBUG_OBJECT (src, "using %s sample kernels",
+      src->kernels ? src->kernels->name : "scalar");
+
   src->info = info;
   
   src->phase = 0.0;
@@ -766,27 +5004,44 @@ gst_morse_src_setcaps (GstBaseSrc *basesrc, GstCaps *caps)
   switch (GST_AUDIO_FORMAT_INFO_FORMAT (src->info.finfo))
     {
     case GST_AUDIO_FORMAT_S16:
-      src->cwfunc = MORSE_CW_GENERATE_gint16;
+      src->cwfunc = CW_GENERATE_SELECT (src, gint16);
+      src->mixfunc = MORSE_MIX_STORE_gint16;
       break;
     case GST_AUDIO_FORMAT_S32:
-      src->cwfunc = MORSE_CW_GENERATE_gint32;
+      src->cwfunc = CW_GENERATE_SELECT (src, gint32);
+      src->mixfunc = MORSE_MIX_STORE_gint32;
       break;
     case GST_AUDIO_FORMAT_F32:
-      src->cwfunc = MORSE_CW_GENERATE_gfloat;
+      src->cwfunc = CW_GENERATE_SELECT (src, gfloat);
+      src->mixfunc = MORSE_MIX_STORE_gfloat;
       break;
     case GST_AUDIO_FORMAT_F64:
-      src->cwfunc = MORSE_CW_GENERATE_gdouble;
+      src->cwfunc = CW_GENERATE_SELECT (src, gdouble);
+      src->mixfunc = MORSE_MIX_STORE_gdouble;
       break;
     default:
+      for (guint n = 0; n < G_N_ELEMENTS (morse_direct_formats); n++) {
+        if (morse_direct_formats[n].format ==
+            GST_AUDIO_FORMAT_INFO_FORMAT (src->info.finfo)) {
+          src->cwfunc = morse_direct_formats[n].generate;
+          src->mixfunc = morse_direct_formats[n].mix;
+        }
+      }
+      if (src->cwfunc)
+        break;
+
+      // Anything else is generated unpacked and packed afterwards
       switch (src->info.finfo->unpack_format)
         {
         case GST_AUDIO_FORMAT_S32:
-          src->cwfunc = MORSE_CW_GENERATE_gint32;
+          src->cwfunc = CW_GENERATE_SELECT (src, gint32);
+          src->mixfunc = MORSE_MIX_STORE_gint32;
           src->packfunc = src->info.finfo->pack_func;
           src->packsize = sizeof (gint32);
           break;
         case GST_AUDIO_FORMAT_F64:
-          src->cwfunc = MORSE_CW_GENERATE_gdouble;
+          src->cwfunc = CW_GENERATE_SELECT (src, gdouble);
+          src->mixfunc = MORSE_MIX_STORE_gdouble;
           src->packfunc = src->info.finfo->pack_func;
           src->packsize = sizeof (gdouble);
           break;
@@ -794,6 +5049,21 @@ gst_morse_src_setcaps (GstBaseSrc *basesrc, GstCaps *caps)
           g_assert_not_reached ();
         }
     }
+
+  gst_morse_src_apply_block (src);
+  src->block_samples = CLAMP (gst_base_src_get_blocksize (basesrc) /
+      GST_AUDIO_INFO_BPF (&src->info), 1,
+      (guint) (G_MAXINT / GST_AUDIO_INFO_BPF (&src->info)));
+
+  // Unpacked intermediate for packfunc formats, sized once per caps
+  g_free (src->scratch);
+  src->scratch = NULL;
+  src->scratch_samples = 0;
+  if (src->packfunc)
+    gst_morse_src_alloc_scratch (src, src->block_samples);
+
+  if (src->symbol_cache)
+    gst_morse_src_build_cache (src);
   
   return TRUE;
 
@@ -808,21 +5078,63 @@ static gboolean
 gst_morse_src_start (GstBaseSrc *basesrc)
 {
   GstMorseSrc *src = GST_MORSE_SRC (basesrc);
+  guint char_gap, word_gap;
+  MorseTable *table;
 
   // Configure base source properties
-  gst_base_src_set_live(basesrc, FALSE);
+  gst_base_src_set_live(basesrc, src->is_live);
   gst_base_src_set_format(basesrc, GST_FORMAT_TIME);
 
   // Reset playback state
   src->playback_complete = FALSE;
+  src->live_started = FALSE;
+  src->keyed = FALSE;
+  morse_channel_reset (&src->channel, src->seed ? src->seed : g_random_int ());
+  src->channel_offset = 0;
+
+  // Text from the sink pad blocks on upstream and a waiting one-shot
+  // element on the next text, neither may hold a pool worker
+  gst_morse_src_pool_flush (src);
+  src->pooled = src->render_pool && !src->stream_pad &&
+      !(src->one_shot && src->one_shot_mode == GST_MORSE_ONE_SHOT_MODE_WAIT);
+
+  g_mutex_lock (&src->stream_lock);
+  src->streaming = TRUE;
+  src->stream_eos = FALSE;
+  src->stream_flushing = FALSE;
+  src->stream_stopped = FALSE;
+  g_mutex_unlock (&src->stream_lock);
+
+  // Text set before the stream started is the first message, the rest of
+  // an append queue follows it
+  MorseMessage *msg = NULL, *next;
+  while (!src->stream_pad && (next = gst_morse_src_queue_pop (src))) {
+    if (msg) {
+      MORSE_STAT_ADD (src, texts_dropped, 1);
+      morse_message_free (msg);
+    }
+    msg = next;
+    if (src->queue_mode == GST_MORSE_QUEUE_MODE_APPEND)
+      break;
+  }
+  if (msg)
+    MORSE_STAT_ADD (src, texts_applied, 1);
 
+  gst_morse_src_lock (src);
   if (src->generated_morse)
     {
-      g_string_free(src->generated_morse, TRUE);
+      morse_code_free (src->generated_morse);
     }
+  src->generated_morse = NULL;
+
+  if (msg) {
+    g_free (src->text);
+    src->text = msg->text;
+    src->generated_morse = msg->morse;
+    src->text_set_time = msg->set_time;
+    g_free (msg);
+  }
 
-  src->generated_morse = g_string_new(NULL);
-  
   // Validate text before processing
   if (!src->text || strlen(src->text) == 0) {
     GST_WARNING_OBJECT (src, "No text provided, using default");
@@ -830,9 +5142,41 @@ gst_morse_src_start (GstBaseSrc *basesrc)
     src->text = g_strdup("OK");
   }
   
-  morse_send_string(src->generated_morse, src->text);
+  // A requested sink pad replaces the text property as the input
+  gst_morse_src_spacing (src, &char_gap, &word_gap);
+  table = gst_morse_src_get_table (src);
+  if (src->stream_pad)
+    src->generated_morse = morse_code_new (table, "", 0, TRUE, char_gap,
+        word_gap);
+  else if (!src->generated_morse)
+    src->generated_morse = morse_code_new (table, src->text,
+        strlen (src->text), FALSE, char_gap, word_gap);
+  morse_table_unref (table);
+
+  // Voices start over from their first character, prepared again for
+  // whatever caps get negotiated
+  if (src->voices_changed) {
+    if (src->voices)
+      g_ptr_array_unref (src->voices);
+    src->voices = src->pending_voices;
+    src->pending_voices = NULL;
+    src->voices_changed = FALSE;
+  }
+  for (guint v = 0; src->voices && v < src->voices->len; v++) {
+    MorseVoice *voice = g_ptr_array_index (src->voices, v);
+
+    morse_voice_rewind (voice);
+    voice->rate = 0;
+  }
+  g_mutex_unlock(&src->lock);
   src->position = 0;
-  src->timestamp = 0;
+  src->symbol_offset = 0;
+  gst_morse_src_shared_reset (src);
+  src->time_base = 0;
+  src->sample_offset = 0;
+  src->text_samples = 0;
+  src->unit_base = 0;
+  src->sample_base = 0;
   src->about_to_finish_posted = FALSE;
 
   // Initialize segment
@@ -864,15 +5208,36 @@ gst_morse_src_stop (GstBaseSrc *basesrc)
 {
   GstMorseSrc *src = GST_MORSE_SRC (basesrc);
 
-  g_mutex_lock(&src->lock);
+  // Release a chain function waiting on a full queue
+  g_mutex_lock (&src->stream_lock);
+  src->streaming = FALSE;
+  src->stream_stopped = TRUE;
+  g_queue_clear_full (&src->stream_queue, (GDestroyNotify) gst_buffer_unref);
+  g_cond_broadcast (&src->stream_cond);
+  g_mutex_unlock (&src->stream_lock);
+
+  // The job in flight finishes with the state it started on
+  gst_morse_src_pool_flush (src);
+  gst_morse_src_encoded_reset (src);
+
+  gst_morse_src_lock (src);
   
   if (src->generated_morse)
     {
-      g_string_free(src->generated_morse, TRUE);
+      morse_code_free (src->generated_morse);
       src->generated_morse = NULL;
     }
+  gst_morse_src_stream_release_buffer (src);
+  src->stream_carry_len = 0;
+  gst_morse_src_shared_reset (src);
   
   src->playback_complete = FALSE;
+
+  g_free (src->scratch);
+  src->scratch = NULL;
+  src->scratch_samples = 0;
+  GST_DEBUG_OBJECT (src, "%" G_GUINT64_FORMAT " allocations so far",
+      MORSE_STAT_GET (src, allocations));
   
   g_mutex_unlock(&src->lock);
 
@@ -885,18 +5250,130 @@ gst_morse_src_init (GstMorseSrc *src)
   src->frequency = DEFAULT_FREQUENCY;
   src->volume = DEFAULT_VOLUME;
   src->wpm = DEFAULT_WPM;
+  src->wpm_requested = DEFAULT_WPM;
+  src->high_speed = DEFAULT_HIGH_SPEED;
+  src->farnsworth_wpm = DEFAULT_FARNSWORTH_WPM;
+  src->table = morse_table_builtin ();
+  src->table_file = NULL;
   src->one_shot = FALSE;
+  src->one_shot_mode = DEFAULT_ONE_SHOT_MODE;
+  src->about_to_finish_time = DEFAULT_ABOUT_TO_FINISH_TIME;
+  src->gapless = DEFAULT_GAPLESS;
+  src->chained = FALSE;
+  src->rearmed = FALSE;
   src->text = g_strdup("OK");  
+  src->text_prop = NULL;
   src->generated_morse = NULL;
   src->position = 0;
-  src->timestamp = 0;
+  src->time_base = 0;
+  src->sample_offset = 0;
+  src->dot_num = 0;
+  src->dot_den = 0;
+  src->timing_dirty = FALSE;
+  src->text_samples = 0;
+  src->unit_base = 0;
+  src->sample_base = 0;
   src->phase = 0.0;
   src->phase_increment = 0.0;
+  src->controlled = FALSE;
+  src->level = src->volume;
+  src->control_volume = src->volume;
+  src->volume_slope = 0.0;
+  src->control_increment = 0.0;
+  src->increment_slope = 0.0;
+  src->oscillator = DEFAULT_OSCILLATOR;
+  src->simd = DEFAULT_SIMD;
+  src->kernels = NULL;
+  src->symbol_cache = DEFAULT_SYMBOL_CACHE;
+  src->rise_time = DEFAULT_RISE_TIME;
+  src->envelope = DEFAULT_ENVELOPE;
+  src->envelope_dirty = FALSE;
+  src->noise = DEFAULT_NOISE;
+  src->snr = DEFAULT_SNR;
+  src->fading = DEFAULT_FADING;
+  src->fading_rate = DEFAULT_FADING_RATE;
+  src->chirp = DEFAULT_CHIRP;
+  src->drift = DEFAULT_DRIFT;
+  src->seed = DEFAULT_SEED;
+  src->simulating = FALSE;
+  src->mute = FALSE;
+  src->noise_sigma = 0.0;
+  morse_channel_reset (&src->channel, 1);
+  src->channel_offset = 0;
+  memset (src->envelopes, 0, sizeof (src->envelopes));
+  src->envelope_next = 0;
+  src->cache_dirty = TRUE;
+  src->cache = NULL;
+  src->samples_per_buffer = DEFAULT_SAMPLES_PER_BUFFER;
+  src->buffer_time = DEFAULT_BUFFER_TIME;
+  src->user_blocksize = FALSE;
+  src->block_samples = 0;
+  src->scratch = NULL;
+  src->scratch_samples = 0;
+  memset (&src->stats, 0, sizeof (src->stats));
+  src->stats.text_latency = GST_CLOCK_TIME_NONE;
+  src->symbol_offset = 0;
+  src->is_live = DEFAULT_IS_LIVE;
+  src->latency_time = DEFAULT_LATENCY_TIME;
+  src->live_started = FALSE;
+  src->text_set_time = GST_CLOCK_TIME_NONE;
+  gst_base_src_set_live (GST_BASE_SRC (src), src->is_live);
+
+  g_signal_connect (src, "notify::blocksize",
+      G_CALLBACK (gst_morse_src_blocksize_notify), NULL);
   
   // Initialize new members
   g_mutex_init(&src->lock);
-  src->new_text_pending = FALSE;
-  src->pending_text = NULL;
+  src->queue_mode = DEFAULT_QUEUE_MODE;
+  src->gap_mode = DEFAULT_GAP_MODE;
+  src->silence = NULL;
+  src->keying_messages = DEFAULT_KEYING_MESSAGES;
+  src->render_audio = DEFAULT_RENDER_AUDIO;
+  src->keyed = FALSE;
+  src->queue_head = 0;
+  src->queue_tail = 0;
+  for (gint i = 0; i < MORSE_TEXT_QUEUE_SIZE; i++)
+    src->queue_seq[i] = i;
+  src->text_waiting = FALSE;
+  src->stream_pad = NULL;
+  g_mutex_init (&src->stream_lock);
+  g_cond_init (&src->stream_cond);
+  g_queue_init (&src->stream_queue);
+  src->render_pool = DEFAULT_RENDER_POOL;
+  src->render_ahead = DEFAULT_RENDER_AHEAD;
+  src->pooled = FALSE;
+  g_queue_init (&src->pool_queue);
+  src->pool_scheduled = FALSE;
+  src->pool_flushing = FALSE;
+  src->pool_done = FALSE;
+  src->pool_segment = NULL;
+  src->encoder = NULL;
+  src->encoded_format = NULL;
+  src->encoded_caps = NULL;
+  g_queue_init (&src->encoded_pending);
+  src->encoded_flow = GST_FLOW_OK;
+  src->encoded_replay = NULL;
+  src->encoded_recording = NULL;
+  src->encoded_key = NULL;
+  src->stream_eos = FALSE;
+  src->stream_flushing = FALSE;
+  src->stream_stopped = TRUE;
+  src->streaming = FALSE;
+  src->stream_buffer = NULL;
+  src->stream_carry_len = 0;
+  src->stream_joined = NULL;
+  src->voices_desc = NULL;
+  src->voices = NULL;
+  src->pending_voices = NULL;
+  src->voices_changed = FALSE;
+  src->voices_channels = 1;
+  src->mixfunc = NULL;
+  src->mix = NULL;
+  src->mix_samples = 0;
+  src->shared_cache = DEFAULT_SHARED_CACHE;
+  src->shared_memory = NULL;
+  src->shared_recording = NULL;
+  src->shared_key = NULL;
   src->about_to_finish_posted = FALSE;
   src->playback_complete = FALSE;
   src->state = GST_STATE_NULL;
@@ -919,6 +5396,9 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
   gobject_class->finalize = gst_morse_src_finalize;
 
   element_class->change_state = GST_DEBUG_FUNCPTR (gst_morse_src_change_state);
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_morse_src_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_morse_src_release_pad);
 
   // Install properties with limits
   g_object_class_install_property (gobject_class, PROP_FREQUENCY,
@@ -927,7 +5407,7 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
           MIN_FREQUENCY,
           MAX_FREQUENCY,
           DEFAULT_FREQUENCY,
-          G_PARAM_READWRITE));
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
 
   g_object_class_install_property (gobject_class, PROP_VOLUME,
       g_param_spec_double ("volume", "Volume", 
@@ -935,15 +5415,15 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
           MIN_VOLUME,
           MAX_VOLUME,
           DEFAULT_VOLUME,
-          G_PARAM_READWRITE));
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
 
   g_object_class_install_property (gobject_class, PROP_WPM,
       g_param_spec_int ("wpm", "Words per minute", 
-          "Speed in words per minute (5-30 WPM)",
+          "Speed in words per minute (5-30 WPM, up to 10000 with high-speed)",
           MIN_WPM,
-          MAX_WPM,
+          MAX_HSCW_WPM,
           DEFAULT_WPM,
-          G_PARAM_READWRITE));
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
 
   g_object_class_install_property (gobject_class, PROP_TEXT,
       g_param_spec_string ("text", "Morse text",
@@ -952,12 +5432,261 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
 
   g_object_class_install_property (gobject_class, PROP_ONE_SHOT,
       g_param_spec_boolean ("one-shot", "One Shot Mode",
-          "Automatically transition to READY state after playback completes",
+          "Post morse-playback-complete after the message, then act on one-shot-mode",
           FALSE,
           G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_ONE_SHOT_MODE,
+      g_param_spec_enum ("one-shot-mode", "One-shot mode",
+          "What a one-shot element does after its message: go to READY, send EOS or wait for the next text",
+          GST_TYPE_MORSE_ONE_SHOT_MODE,
+          DEFAULT_ONE_SHOT_MODE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ABOUT_TO_FINISH_TIME,
+      g_param_spec_uint64 ("about-to-finish-time", "About to finish time",
+          "Post about-to-finish this many nanoseconds before the end of a message",
+          0, G_MAXUINT64, DEFAULT_ABOUT_TO_FINISH_TIME,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_GAPLESS,
+      g_param_spec_boolean ("gapless", "Gapless",
+          "Chain queued messages on the next sample, in the same buffer and segment",
+          DEFAULT_GAPLESS,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_OSCILLATOR,
+      g_param_spec_enum ("oscillator", "Oscillator",
+          "Tone engine used to render the carrier",
+          GST_TYPE_MORSE_OSCILLATOR,
+          DEFAULT_OSCILLATOR,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Vectorised sample kernels, applied at caps negotiation",
+          GST_TYPE_MORSE_SIMD,
+          DEFAULT_SIMD,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SYMBOL_CACHE,
+      g_param_spec_boolean ("symbol-cache", "Symbol Cache",
+          "Copy dits, dahs and gaps from blocks pre-rendered per caps/WPM/frequency/volume",
+          DEFAULT_SYMBOL_CACHE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_HIGH_SPEED,
+      g_param_spec_boolean ("high-speed", "High speed",
+          "Allow up to 10000 WPM and dots down to 2 samples, keyed elements follow the exact dot grid",
+          DEFAULT_HIGH_SPEED,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_FARNSWORTH_WPM,
+      g_param_spec_int ("farnsworth-wpm", "Farnsworth WPM",
+          "Overall speed with characters sent at wpm and the spacing stretched, 0 for standard spacing",
+          0,
+          MAX_HSCW_WPM,
+          DEFAULT_FARNSWORTH_WPM,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_TABLE_FILE,
+      g_param_spec_string ("table-file", "Table file",
+          "Code table loaded on top of the built-in one, one \"character code\" per line, e.g. data/cyrillic.txt",
+          NULL,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RISE_TIME,
+      g_param_spec_uint64 ("rise-time", "Rise time",
+          "Rise and fall time of each element in nanoseconds, at most half the element",
+          0, GST_SECOND, DEFAULT_RISE_TIME,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ENVELOPE,
+      g_param_spec_enum ("envelope", "Envelope",
+          "Shape of the rise and fall of each element",
+          GST_TYPE_MORSE_ENVELOPE,
+          DEFAULT_ENVELOPE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_NOISE,
+      g_param_spec_boolean ("noise", "Noise",
+          "Add white Gaussian noise at snr, in the gaps too",
+          DEFAULT_NOISE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SNR,
+      g_param_spec_double ("snr", "SNR",
+          "Signal to noise ratio in dB in a 2500 Hz bandwidth, relative to volume",
+          -30.0,
+          60.0,
+          DEFAULT_SNR,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
+
+  g_object_class_install_property (gobject_class, PROP_FADING,
+      g_param_spec_enum ("fading", "Fading",
+          "Fading model of the simulated channel",
+          GST_TYPE_MORSE_FADING,
+          DEFAULT_FADING,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_FADING_RATE,
+      g_param_spec_double ("fading-rate", "Fading rate",
+          "Doppler spread of the fading in Hz",
+          0.01,
+          10.0,
+          DEFAULT_FADING_RATE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_CHIRP,
+      g_param_spec_double ("chirp", "Chirp",
+          "Frequency offset in Hz at key-down, settling within about 15 ms",
+          0.0,
+          500.0,
+          DEFAULT_CHIRP,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DRIFT,
+      g_param_spec_double ("drift", "Drift",
+          "RMS of a slow random frequency drift in Hz",
+          0.0,
+          100.0,
+          DEFAULT_DRIFT,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SEED,
+      g_param_spec_uint ("seed", "Seed",
+          "Seed of the channel simulation, 0 for a random one",
+          0,
+          G_MAXUINT,
+          DEFAULT_SEED,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SAMPLES_PER_BUFFER,
+      g_param_spec_uint ("samples-per-buffer", "Samples per buffer",
+          "Number of samples in each outgoing buffer",
+          1, G_MAXINT,
+          DEFAULT_SAMPLES_PER_BUFFER,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_BUFFER_TIME,
+      g_param_spec_uint64 ("buffer-time", "Buffer time",
+          "Duration of each outgoing buffer in nanoseconds, overrides samples-per-buffer (0 = disabled)",
+          0, G_MAXUINT64,
+          DEFAULT_BUFFER_TIME,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_IS_LIVE,
+      g_param_spec_boolean ("is-live", "Is Live",
+          "Synchronise output to the pipeline clock and apply new text at the next element",
+          DEFAULT_IS_LIVE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_TIME,
+      g_param_spec_uint64 ("latency-time", "Latency time",
+          "Duration of each outgoing buffer in live mode in nanoseconds (0 = use buffer-time/samples-per-buffer)",
+          0, G_MAXUINT64,
+          DEFAULT_LATENCY_TIME,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_MODE,
+      g_param_spec_enum ("queue-mode", "Queue mode",
+          "How text set or pushed while playing takes over from the current message",
+          GST_TYPE_MORSE_QUEUE_MODE,
+          DEFAULT_QUEUE_MODE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_GAP_MODE,
+      g_param_spec_enum ("gap-mode", "Gap mode",
+          "Send the silence between elements as GAP buffers or GAP events "
+          "instead of rendering it, tone and silence get separate buffers",
+          GST_TYPE_MORSE_GAP_MODE,
+          DEFAULT_GAP_MODE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_KEYING_MESSAGES,
+      g_param_spec_boolean ("keying-messages", "Keying messages",
+          "Post a morse-keying message with the timestamp and sample offset of every key-down and key-up",
+          DEFAULT_KEYING_MESSAGES,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RENDER_AUDIO,
+      g_param_spec_boolean ("render-audio", "Render audio",
+          "Generate the tone, when FALSE only GAP buffers are pushed and keying messages are posted",
+          DEFAULT_RENDER_AUDIO,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_VOICES,
+      g_param_spec_string ("voices", "Voices",
+          "Independent messages mixed into one output, e.g. "
+          "\"voice, text=CQ, frequency=600, wpm=18, volume=0.4, pan=-0.5, "
+          "repeat=true; voice, text=TEST, channel=1\". Replaces text while set",
+          NULL,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SHARED_CACHE,
+      g_param_spec_boolean ("shared-cache", "Shared Cache",
+          "Share rendered messages with every morsesrc in the process, keyed on text, frequency, wpm, volume and caps",
+          DEFAULT_SHARED_CACHE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SHARED_CACHE_SIZE,
+      g_param_spec_uint64 ("shared-cache-size", "Shared cache size",
+          "Bytes the process-wide render cache may hold, least recently used messages are evicted first",
+          0, G_MAXUINT64,
+          DEFAULT_SHARED_CACHE_SIZE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RENDER_POOL,
+      g_param_spec_boolean ("render-pool", "Render pool",
+          "Render on a process-wide worker pool of one thread per core, create() only dequeues",
+          DEFAULT_RENDER_POOL,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RENDER_AHEAD,
+      g_param_spec_uint ("render-ahead", "Render ahead",
+          "Buffers the render pool keeps ready ahead of create()",
+          1, 64, DEFAULT_RENDER_AHEAD,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ALLOCATIONS,
+      g_param_spec_uint64 ("allocations", "Allocations",
+          "Output buffers, scratch areas and envelope tables allocated so far",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Buffers, samples, generate/pack time (ns), allocations, texts applied/dropped, "
+          "lock waits and the last text-to-audio latency (ns)",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE));
+
+  /**
+   * GstMorseSrc::push-text:
+   * @src: the morsesrc
+   * @text: the message to send
+   *
+   * Encode @text and queue it without blocking on the streaming thread.
+   * Safe from any number of threads at once, and alongside setting
+   * "text". Returns %FALSE when the queue is full and the message was
+   * dropped.
+   */
+  gst_morse_src_signals[SIGNAL_PUSH_TEXT] =
+      g_signal_new ("push-text", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstMorseSrcClass, push_text), NULL, NULL, NULL,
+      G_TYPE_BOOLEAN, 1, G_TYPE_STRING);
+
+  klass->push_text = gst_morse_src_push_text;
+
+  morse_wavetable_init ();
+  morse_buffer_quark = g_quark_from_static_string ("morsesrc-buffer");
+  morse_shared_table = g_hash_table_new (g_str_hash, g_str_equal);
+
   gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
       &src_template);
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
+      &sink_template);
 
   gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
       "Morse Code to Audio",
@@ -966,11 +5695,15 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
       "  Features\n"
       "                           • Text to morse code conversion\n"
       "                           • Adjustable frequency (400-2000 Hz)\n"
-      "                           • Variable speed (5-30 WPM)\n"
+      "                           • Variable speed (5-30 WPM, 10000 with "
+      "high-speed)\n"
       "                           • Volume control (0.0-1.0)\n"
       "                           • One-shot mode support\n"
       "                           • About-to-finish notification\n"
-      "                           • Envelope shaping to reduce clicks\n\n"
+      "                           • Envelope shaping to reduce clicks\n"
+      "                           • Selectable tone engine\n"
+      "                           • Text input from a sink pad\n"
+      "                           • Multiple voices mixed in one pass\n\n"
       "  Build Date               " BUILD_DATE "\n"
       "  Version                  " PACKAGE_VERSION,
       "Robert Hensel <vk3dgtv@gmail.com>"); 
@@ -980,6 +5713,13 @@ gst_morse_src_class_init (GstMorseSrcClass *klass)
   basesrc_class->stop = GST_DEBUG_FUNCPTR (gst_morse_src_stop);
   basesrc_class->fixate = GST_DEBUG_FUNCPTR (gst_morse_src_fixate);
   basesrc_class->set_caps = GST_DEBUG_FUNCPTR (gst_morse_src_setcaps);
+  basesrc_class->decide_allocation = GST_DEBUG_FUNCPTR (gst_morse_src_decide_allocation);
+  basesrc_class->query = GST_DEBUG_FUNCPTR (gst_morse_src_query);
+  basesrc_class->get_times = GST_DEBUG_FUNCPTR (gst_morse_src_get_times);
+  basesrc_class->is_seekable = GST_DEBUG_FUNCPTR (gst_morse_src_is_seekable);
+  basesrc_class->do_seek = GST_DEBUG_FUNCPTR (gst_morse_src_do_seek);
+  basesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_morse_src_unlock);
+  basesrc_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_morse_src_unlock_stop);
   pushsrc_class->create = GST_DEBUG_FUNCPTR (gst_morse_src_create);
 }
 
@@ -993,6 +5733,11 @@ plugin_init (GstPlugin *plugin)
     NULL,
     GST_PLUGIN_DEPENDENCY_FLAG_NONE);
 
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+  if (!gst_tracer_register (plugin, "morsestats", GST_TYPE_MORSE_TRACER))
+    return FALSE;
+#endif
+
   return gst_element_register (plugin, "morsesrc", GST_RANK_NONE,
       GST_TYPE_MORSE_SRC);
 }
@@ -0,0 +1,307 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Code table lookup and loading for morsesrc. A table file holds one entry
+  per line, a key and its code in dots and dashes:
+
+    A .-
+    U+000A .-.-
+    <SK> ...-.-
+
+  A key is one UTF-8 character, U+XXXX, or a prosign name in angle brackets.
+  Empty lines and lines starting with '#' are skipped. tools/gen-morse-table.py
+  reads the same format to build the built-in table.
+*/
+
+#include "gstmorsetable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Built by tools/gen-morse-table.py from data/morse-table.txt
+#include "gstmorsetable-data.h"
+
+G_DEFINE_QUARK (morse-table-error-quark, morse_table_error)
+
+MorseTable *
+morse_table_builtin (void)
+{
+  return &morse_builtin_table;
+}
+
+MorseTable *
+morse_table_ref (MorseTable *table)
+{
+  if (table->refcount > 0)
+    g_atomic_int_inc (&table->refcount);
+  return table;
+}
+
+void
+morse_table_unref (MorseTable *table)
+{
+  if (table->refcount < 0 || !g_atomic_int_dec_and_test (&table->refcount))
+    return;
+
+  g_free (table->name);
+  g_free (table->chars);
+  g_free (table->prosigns);
+  g_free (table);
+}
+
+static gint
+morse_char_compare (gconstpointer a, gconstpointer b)
+{
+  gunichar x = ((const MorseChar *) a)->ch, y = ((const MorseChar *) b)->ch;
+
+  return x < y ? -1 : x > y;
+}
+
+static gint
+morse_prosign_compare (gconstpointer a, gconstpointer b)
+{
+  return strcmp (((const MorseProsign *) a)->name,
+      ((const MorseProsign *) b)->name);
+}
+
+// Characters past ASCII, by their upper case
+static const MorseSymbol *
+morse_table_lookup_char (const MorseTable *table, gunichar ch)
+{
+  MorseChar key;
+  const MorseChar *found;
+
+  key.ch = g_unichar_toupper (ch);
+  found = bsearch (&key, table->chars, table->n_chars, sizeof (MorseChar),
+      morse_char_compare);
+  return found ? &found->symbol : NULL;
+}
+
+static const MorseSymbol *
+morse_table_lookup_prosign (const MorseTable *table, const gchar *name)
+{
+  MorseProsign key;
+  const MorseProsign *found;
+
+  g_strlcpy (key.name, name, sizeof (key.name));
+  found = bsearch (&key, table->prosigns, table->n_prosigns,
+      sizeof (MorseProsign), morse_prosign_compare);
+  return found ? &found->symbol : NULL;
+}
+
+// Name of the prosign at `p`, as in <SK>. Returns the bytes it takes, 0
+// when `p` does not start one.
+static gsize
+morse_prosign_name (const gchar *p, const gchar *end,
+    gchar name[MORSE_PROSIGN_MAX + 1])
+{
+  gsize n = 0;
+
+  if (*p != '<')
+    return 0;
+
+  for (p++; p < end && n < MORSE_PROSIGN_MAX && g_ascii_isalnum (*p); p++)
+    name[n++] = g_ascii_toupper (*p);
+  name[n] = '\0';
+
+  return n > 0 && p < end && *p == '>' ? n + 2 : 0;
+}
+
+MorseToken
+morse_table_next (const MorseTable *table, const gchar **p, const gchar *end,
+    MorseSymbol *symbol)
+{
+  const MorseSymbol *found;
+  gchar name[MORSE_PROSIGN_MAX + 1];
+  gunichar ch;
+  gsize n;
+
+  // Plain ASCII is the common case and needs no decoding
+  if ((guchar) **p < 0x80) {
+    ch = (guchar) *(*p)++;
+
+    if ((found = table->ascii[ch].length ? &table->ascii[ch] : NULL)) {
+      *symbol = *found;
+      return MORSE_TOKEN_SYMBOL;
+    }
+    if (ch == '<' && (n = morse_prosign_name (*p - 1, end, name)) &&
+        (found = morse_table_lookup_prosign (table, name))) {
+      *p += n - 1;
+      *symbol = *found;
+      return MORSE_TOKEN_SYMBOL;
+    }
+    return g_ascii_isspace (ch) ? MORSE_TOKEN_SPACE : MORSE_TOKEN_SKIP;
+  }
+
+  ch = g_utf8_get_char_validated (*p, end - *p);
+  if (ch == (gunichar) -1 || ch == (gunichar) -2) {
+    (*p)++;
+    return MORSE_TOKEN_SKIP;
+  }
+  *p = g_utf8_next_char (*p);
+
+  if ((found = morse_table_lookup_char (table, ch))) {
+    *symbol = *found;
+    return MORSE_TOKEN_SYMBOL;
+  }
+  return g_unichar_isspace (ch) ? MORSE_TOKEN_SPACE : MORSE_TOKEN_SKIP;
+}
+
+// Parse "key code" into `table`, growing the character and prosign arrays
+static gboolean
+morse_table_parse_line (MorseTable *table, GArray *chars, GArray *prosigns,
+    gchar *line)
+{
+  gchar **fields = g_strsplit_set (g_strstrip (line), " \t", -1);
+  gchar *key = NULL, *code = NULL;
+  MorseSymbol symbol = { 0, 0 };
+  gboolean ok = FALSE;
+  guint n = 0;
+
+  for (gchar **f = fields; *f; f++) {
+    if (**f == '\0')
+      continue;
+    if (n == 0)
+      key = *f;
+    else if (n == 1)
+      code = *f;
+    n++;
+  }
+
+  if (n == 2 && strlen (code) <= MORSE_SYMBOL_MAX &&
+      strspn (code, ".-") == strlen (code)) {
+    gchar name[MORSE_PROSIGN_MAX + 1];
+    const gchar *end = key + strlen (key);
+
+    for (symbol.length = 0; code[symbol.length]; symbol.length++)
+      if (code[symbol.length] == '-')
+        symbol.bits |= 1 << symbol.length;
+
+    if (morse_prosign_name (key, end, name) == strlen (key)) {
+      MorseProsign prosign;
+
+      g_strlcpy (prosign.name, name, sizeof (prosign.name));
+      prosign.symbol = symbol;
+      g_array_append_val (prosigns, prosign);
+      ok = TRUE;
+    } else {
+      MorseChar entry;
+      gchar *rest = NULL;
+
+      if (g_ascii_strncasecmp (key, "U+", 2) == 0 && key[2]) {
+        entry.ch = g_ascii_strtoull (key + 2, &rest, 16);
+        ok = rest && *rest == '\0';
+      } else {
+        entry.ch = g_utf8_get_char_validated (key, -1);
+        ok = entry.ch != (gunichar) -1 && entry.ch != (gunichar) -2 &&
+            *g_utf8_next_char (key) == '\0';
+      }
+
+      if (ok) {
+        entry.ch = g_unichar_toupper (entry.ch);
+        entry.symbol = symbol;
+        if (entry.ch < 128) {
+          table->ascii[entry.ch] = symbol;
+          if (g_ascii_isupper (entry.ch))
+            table->ascii[(guchar) g_ascii_tolower (entry.ch)] = symbol;
+        } else {
+          g_array_append_val (chars, entry);
+        }
+      }
+    }
+  }
+
+  g_strfreev (fields);
+  return ok;
+}
+
+// Keep the last of equal entries, the loaded file wins over the built-in
+static guint
+morse_table_dedup (GArray *array, GCompareFunc compare)
+{
+  guint size = g_array_get_element_size (array), out = 0;
+
+  for (guint i = 0; i < array->len; i++) {
+    gpointer from = array->data + i * size;
+
+    if (out > 0 && compare (array->data + (out - 1) * size, from) == 0)
+      out--;
+    memmove (array->data + out * size, from, size);
+    out++;
+  }
+  g_array_set_size (array, out);
+  return out;
+}
+
+MorseTable *
+morse_table_load (const gchar *path, GError **error)
+{
+  MorseTable *builtin = morse_table_builtin ();
+  MorseTable *table;
+  GArray *chars, *prosigns;
+  gchar *contents, *checksum, **lines;
+  guint lineno = 0;
+  gboolean ok = TRUE;
+
+  if (!g_file_get_contents (path, &contents, NULL, error))
+    return NULL;
+
+  table = g_new0 (MorseTable, 1);
+  table->refcount = 1;
+  // Named by content as well, so audio cached for an earlier version of
+  // the file is not taken for this one
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, contents, -1);
+  table->name = g_strdup_printf ("%s#%s", path, checksum);
+  g_free (checksum);
+  memcpy (table->ascii, builtin->ascii, sizeof (table->ascii));
+
+  chars = g_array_new (FALSE, FALSE, sizeof (MorseChar));
+  prosigns = g_array_new (FALSE, FALSE, sizeof (MorseProsign));
+  g_array_append_vals (chars, builtin->chars, builtin->n_chars);
+  g_array_append_vals (prosigns, builtin->prosigns, builtin->n_prosigns);
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (gchar **line = lines; *line && ok; line++) {
+    lineno++;
+    g_strstrip (*line);
+    if (**line == '\0' || **line == '#')
+      continue;
+
+    if (!morse_table_parse_line (table, chars, prosigns, *line)) {
+      g_set_error (error, MORSE_TABLE_ERROR, 0, "%s:%u: bad entry \"%s\"",
+          path, lineno, *line);
+      ok = FALSE;
+    }
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  // Stable sorts, so entries from the file come after the built-in ones
+  g_array_sort (chars, morse_char_compare);
+  g_array_sort (prosigns, morse_prosign_compare);
+  table->n_chars = morse_table_dedup (chars, morse_char_compare);
+  table->n_prosigns = morse_table_dedup (prosigns, morse_prosign_compare);
+  table->chars = (MorseChar *) g_array_free (chars, FALSE);
+  table->prosigns = (MorseProsign *) g_array_free (prosigns, FALSE);
+
+  if (!ok) {
+    morse_table_unref (table);
+    return NULL;
+  }
+
+  return table;
+}
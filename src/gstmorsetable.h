@@ -0,0 +1,91 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Code tables of the morsesrc encoder. The built-in table is generated at
+  build time from data/morse-table.txt, alternate tables in the same format
+  are loaded at runtime on top of it. morse_table_next reads UTF-8 text one
+  character or <PROSIGN> at a time, the encoder and the seek index both go
+  through it so they always agree on the units a text takes.
+*/
+
+#ifndef __GST_MORSE_TABLE_H__
+#define __GST_MORSE_TABLE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Longest code and prosign name a table may hold
+#define MORSE_SYMBOL_MAX 16
+#define MORSE_PROSIGN_MAX 8
+
+// One character's code, `length` symbols sent from bit 0 up, 1 is a dah
+typedef struct {
+  guint16 bits;
+  guint8 length;
+} MorseSymbol;
+
+typedef struct {
+  gunichar ch;
+  MorseSymbol symbol;
+} MorseChar;
+
+typedef struct {
+  gchar name[MORSE_PROSIGN_MAX + 1];
+  MorseSymbol symbol;
+} MorseProsign;
+
+// ASCII is looked up directly, other characters (by upper case code point)
+// and prosigns (by name) are binary searched. A loaded table is named by
+// its path and a checksum of its contents.
+typedef struct {
+  gint refcount;
+  gchar *name;
+  MorseSymbol ascii[128];
+  guint n_chars;
+  MorseChar *chars;
+  guint n_prosigns;
+  MorseProsign *prosigns;
+} MorseTable;
+
+typedef enum {
+  MORSE_TOKEN_SYMBOL,
+  MORSE_TOKEN_SPACE,
+  MORSE_TOKEN_SKIP
+} MorseToken;
+
+#define MORSE_TABLE_ERROR (morse_table_error_quark ())
+GQuark morse_table_error_quark (void);
+
+// The built-in table, never freed
+MorseTable *morse_table_builtin (void);
+
+// Load `path` on top of the built-in table
+MorseTable *morse_table_load (const gchar *path, GError **error);
+
+MorseTable *morse_table_ref (MorseTable *table);
+void morse_table_unref (MorseTable *table);
+
+// Read the character or prosign at *p, at most up to `end`, and move *p
+// past it. Text the table has no code for is skipped, invalid UTF-8 a byte
+// at a time.
+MorseToken morse_table_next (const MorseTable *table, const gchar **p,
+    const gchar *end, MorseSymbol *symbol);
+
+G_END_DECLS
+
+#endif /* __GST_MORSE_TABLE_H__ */
@@ -0,0 +1,136 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  "morsestats" tracer. Enabled with GST_TRACERS=morsestats it hooks buffer
+  pushes and, for pads of a morsesrc, logs the element's "stats" structure
+  as a morsesrc-stats tracer record. The element keeps counting whether or
+  not the tracer is loaded, the tracer only makes the counters show up in
+  the GST_TRACER log next to the core tracers:
+
+    GST_TRACERS=morsestats GST_DEBUG=GST_TRACER:7 gst-launch-1.0 morsesrc ! fakesink
+*/
+
+#include "gstmorsetracer.h"
+
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+
+struct _GstMorseTracer
+{
+  GstTracer parent;
+};
+
+struct _GstMorseTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+G_DEFINE_TYPE (GstMorseTracer, gst_morse_tracer, GST_TYPE_TRACER)
+
+static GstTracerRecord *tr_stats;
+
+// Counters of the morsesrc "stats" structure, logged in this order
+static const gchar *const morse_tracer_fields[] = {
+  "buffers", "samples", "generate-time", "pack-time", "allocations",
+  "texts-applied", "texts-dropped", "lock-waits", "text-latency"
+};
+
+#define MORSE_TRACER_N_FIELDS G_N_ELEMENTS (morse_tracer_fields)
+
+static void
+do_push_buffer_pre (GstTracer *self, GstClockTime ts, GstPad *pad,
+    GstBuffer *buffer)
+{
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+  GstElementFactory *factory;
+  GstStructure *stats = NULL;
+  guint64 values[MORSE_TRACER_N_FIELDS] = { 0 };
+
+  if (!parent || !GST_IS_ELEMENT (parent))
+    return;
+
+  factory = gst_element_get_factory (GST_ELEMENT (parent));
+  if (!factory || g_strcmp0 (GST_OBJECT_NAME (factory), "morsesrc") != 0)
+    return;
+
+  g_object_get (parent, "stats", &stats, NULL);
+  if (!stats)
+    return;
+
+  for (guint i = 0; i < MORSE_TRACER_N_FIELDS; i++)
+    gst_structure_get_uint64 (stats, morse_tracer_fields[i], &values[i]);
+  gst_structure_free (stats);
+
+  gst_tracer_record_log (tr_stats, ts, GST_OBJECT_NAME (parent),
+      values[0], values[1], values[2], values[3], values[4], values[5],
+      values[6], values[7], values[8]);
+}
+
+static GstStructure *
+morse_tracer_value (const gchar *description, GstTracerValueFlags flags)
+{
+  return gst_structure_new ("value",
+      "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+      "description", G_TYPE_STRING, description,
+      "flags", GST_TYPE_TRACER_VALUE_FLAGS, flags,
+      NULL);
+}
+
+static void
+gst_morse_tracer_class_init (GstMorseTracerClass *klass)
+{
+  tr_stats = gst_tracer_record_new ("morsesrc-stats.class",
+      "ts", GST_TYPE_STRUCTURE, morse_tracer_value ("event ts",
+          GST_TRACER_VALUE_FLAGS_NONE),
+      "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+          GST_TRACER_VALUE_SCOPE_ELEMENT,
+          NULL),
+      "buffers", GST_TYPE_STRUCTURE, morse_tracer_value ("buffers produced",
+          GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "samples", GST_TYPE_STRUCTURE, morse_tracer_value ("samples produced",
+          GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "generate-time", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "ns spent generating tone", GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "pack-time", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "ns spent packing samples", GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "allocations", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "buffers and scratch areas allocated",
+          GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "texts-applied", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "messages started", GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "texts-dropped", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "messages replaced or rejected before playing",
+          GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "lock-waits", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "times the element lock was contended",
+          GST_TRACER_VALUE_FLAGS_AGGREGATED),
+      "text-latency", GST_TYPE_STRUCTURE, morse_tracer_value (
+          "ns from the last text being set to its first keyed sample",
+          GST_TRACER_VALUE_FLAGS_NONE),
+      NULL);
+  GST_OBJECT_FLAG_SET (tr_stats, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+}
+
+static void
+gst_morse_tracer_init (GstMorseTracer *self)
+{
+  gst_tracing_register_hook (GST_TRACER (self), "pad-push-pre",
+      G_CALLBACK (do_push_buffer_pre));
+}
+
+#endif /* GST_DISABLE_GST_TRACER_HOOKS */
@@ -0,0 +1,38 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  "morsestats" tracer. Enabled with GST_TRACERS=morsestats, it logs the
+  "stats" structure of a morsesrc every time the element pushes a buffer.
+*/
+
+#ifndef __GST_MORSE_TRACER_H__
+#define __GST_MORSE_TRACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MORSE_TRACER (gst_morse_tracer_get_type ())
+
+typedef struct _GstMorseTracer GstMorseTracer;
+typedef struct _GstMorseTracerClass GstMorseTracerClass;
+
+GType gst_morse_tracer_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_MORSE_TRACER_H__ */
@@ -0,0 +1,226 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  libFuzzer target for morsesrc. The first bytes of an input pick the
+  format, channels and rate, the rest is a list of operations: set a
+  writable property to a value taken from the input, "text" and "voices"
+  included, or call create() like basesrc would. Every buffer must hold
+  whole frames and carry on from the last one or start over at 0.
+
+  Values are kept small enough for an input to run in milliseconds, and
+  properties that reach outside the element (files, the clock, threads)
+  are left alone.
+
+  USAGE:
+  CC=clang meson setup fuzzbuild -Dfuzzing=true -Db_sanitize=address,undefined
+  GST_PLUGIN_PATH=fuzzbuild ./fuzzbuild/morsefuzz -max_len=512 corpus/
+*/
+
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#include <gst/audio/audio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FUZZ_BUFFERS_MAX 64
+#define FUZZ_UINT_MAX (1 << 14)       // Samples per buffer, seeds
+#define FUZZ_UINT64_MAX (1 << 26)     // Times in ns, cache sizes
+
+static const gchar *fuzz_formats[] = {
+  "S16LE", "S16BE", "U16LE", "S24_32LE", "U24_32BE", "S32LE", "U32BE",
+  "S24LE", "U24BE", "S20LE", "U18BE", "F32LE", "F32BE", "F64LE", "F64BE"
+};
+
+static const gint fuzz_rates[] = { 8000, 11025, 22050, 44100, 48000, 96000,
+  192000 };
+
+// Properties that reach outside the element
+static const gchar *fuzz_skip[] = { "table-file", "is-live", "render-pool",
+  "name", "parent" };
+
+typedef struct {
+  const guint8 *data;
+  gsize size;
+} FuzzInput;
+
+// Up to four bytes of the input as a number, 0 once it ran out
+static guint32
+fuzz_take (FuzzInput *in, guint bytes)
+{
+  guint32 v = 0;
+
+  for (; bytes > 0 && in->size > 0; bytes--, in->data++, in->size--)
+    v = v << 8 | *in->data;
+  return v;
+}
+
+// A string of up to 255 bytes, as they are
+static gchar *
+fuzz_take_string (FuzzInput *in)
+{
+  gsize length = MIN (fuzz_take (in, 1), in->size);
+  gchar *str = g_strndup ((const gchar *) in->data, length);
+
+  in->data += length;
+  in->size -= length;
+  return str;
+}
+
+// Set `pspec` to a value inside its range taken from the input
+static void
+fuzz_set (GstElement *element, GParamSpec *pspec, FuzzInput *in)
+{
+  GValue value = G_VALUE_INIT;
+  GType type = G_PARAM_SPEC_VALUE_TYPE (pspec);
+
+  g_value_init (&value, type);
+
+  if (G_IS_PARAM_SPEC_BOOLEAN (pspec)) {
+    g_value_set_boolean (&value, fuzz_take (in, 1) & 1);
+  } else if (G_IS_PARAM_SPEC_INT (pspec)) {
+    GParamSpecInt *p = G_PARAM_SPEC_INT (pspec);
+    gint64 range = (gint64) p->maximum - p->minimum + 1;
+
+    g_value_set_int (&value, p->minimum + fuzz_take (in, 2) % range);
+  } else if (G_IS_PARAM_SPEC_UINT (pspec)) {
+    GParamSpecUInt *p = G_PARAM_SPEC_UINT (pspec);
+    guint range = MIN (p->maximum - p->minimum, FUZZ_UINT_MAX) + 1;
+
+    g_value_set_uint (&value, p->minimum + fuzz_take (in, 2) % range);
+  } else if (G_IS_PARAM_SPEC_UINT64 (pspec)) {
+    GParamSpecUInt64 *p = G_PARAM_SPEC_UINT64 (pspec);
+    guint64 range = MIN (p->maximum - p->minimum, FUZZ_UINT64_MAX) + 1;
+
+    g_value_set_uint64 (&value, p->minimum + fuzz_take (in, 4) % range);
+  } else if (G_IS_PARAM_SPEC_DOUBLE (pspec)) {
+    GParamSpecDouble *p = G_PARAM_SPEC_DOUBLE (pspec);
+
+    g_value_set_double (&value, p->minimum +
+        (p->maximum - p->minimum) * fuzz_take (in, 2) / 65535.0);
+  } else if (G_IS_PARAM_SPEC_ENUM (pspec)) {
+    GEnumClass *klass = G_PARAM_SPEC_ENUM (pspec)->enum_class;
+
+    g_value_set_enum (&value,
+        klass->values[fuzz_take (in, 1) % klass->n_values].value);
+  } else if (G_IS_PARAM_SPEC_STRING (pspec)) {
+    g_value_take_string (&value, fuzz_take_string (in));
+  } else {
+    g_value_unset (&value);
+    return;
+  }
+
+  g_object_set_property (G_OBJECT (element), pspec->name, &value);
+  g_value_unset (&value);
+}
+
+static gboolean
+fuzz_writable (GParamSpec *pspec)
+{
+  if ((pspec->flags & (G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY)) !=
+      G_PARAM_WRITABLE)
+    return FALSE;
+  for (guint i = 0; i < G_N_ELEMENTS (fuzz_skip); i++)
+    if (strcmp (pspec->name, fuzz_skip[i]) == 0)
+      return FALSE;
+  return TRUE;
+}
+
+int
+LLVMFuzzerInitialize (int *argc, char ***argv)
+{
+  gst_init (argc, argv);
+  return 0;
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data, size_t size)
+{
+  FuzzInput in = { data, size };
+  GstElement *element = gst_element_factory_make ("morsesrc", NULL);
+  GstBaseSrcClass *bclass;
+  GstPushSrcClass *pclass;
+  GParamSpec **pspecs, **props;
+  guint n_pspecs, n_props = 0, buffers = 0;
+  GstAudioInfo info;
+  GstCaps *caps;
+  guint64 offset = 0;
+
+  g_assert (element);
+
+  bclass = GST_BASE_SRC_GET_CLASS (element);
+  pclass = GST_PUSH_SRC_GET_CLASS (element);
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (element),
+      &n_pspecs);
+  props = g_new (GParamSpec *, n_pspecs);
+  for (guint i = 0; i < n_pspecs; i++)
+    if (fuzz_writable (pspecs[i]))
+      props[n_props++] = pspecs[i];
+  g_assert (n_props > 0);
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING,
+      fuzz_formats[fuzz_take (&in, 1) % G_N_ELEMENTS (fuzz_formats)],
+      "rate", G_TYPE_INT,
+      fuzz_rates[fuzz_take (&in, 1) % G_N_ELEMENTS (fuzz_rates)],
+      "channels", G_TYPE_INT, 1 + fuzz_take (&in, 1) % 8,
+      "layout", G_TYPE_STRING, "interleaved", NULL);
+  if (g_value_get_int (gst_structure_get_value (
+              gst_caps_get_structure (caps, 0), "channels")) > 2)
+    gst_caps_set_simple (caps, "channel-mask", GST_TYPE_BITMASK, 0ULL, NULL);
+  gst_audio_info_from_caps (&info, caps);
+
+  // Properties set before start apply from the first buffer
+  while (in.size > 0 && fuzz_take (&in, 1) % 4 != 0)
+    fuzz_set (element, props[fuzz_take (&in, 1) % n_props], &in);
+
+  if (bclass->start (GST_BASE_SRC (element)) &&
+      bclass->set_caps (GST_BASE_SRC (element), caps)) {
+    while (in.size > 0 && buffers < FUZZ_BUFFERS_MAX) {
+      GstBuffer *buf = NULL;
+      GstFlowReturn ret;
+      gsize bytes;
+
+      if (fuzz_take (&in, 1) % 4 != 0) {
+        fuzz_set (element, props[fuzz_take (&in, 1) % n_props], &in);
+        continue;
+      }
+
+      ret = pclass->create (GST_PUSH_SRC (element), &buf);
+      buffers++;
+      if (ret == GST_FLOW_EOS) {
+        g_object_set (element, "text", "E", NULL);
+        continue;
+      }
+      g_assert (ret == GST_FLOW_OK);
+
+      bytes = gst_buffer_get_size (buf);
+      g_assert (bytes % GST_AUDIO_INFO_BPF (&info) == 0);
+      g_assert (GST_BUFFER_OFFSET (buf) == offset ||
+          GST_BUFFER_OFFSET (buf) == 0);
+      offset = GST_BUFFER_OFFSET_END (buf);
+      gst_buffer_unref (buf);
+    }
+    bclass->stop (GST_BASE_SRC (element));
+  }
+
+  gst_caps_unref (caps);
+  g_free (props);
+  g_free (pspecs);
+  gst_object_unref (element);
+  return 0;
+}
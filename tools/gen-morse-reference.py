@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+#
+# This file is part of [morsesrc].
+#
+# [morsesrc] is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# [morsesrc] is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+#
+# Write the reference corpus `morsebench --reference` checks the element
+# against, tests/morse-reference.txt. For every case it holds the length of
+# the message in samples and the span of every keyed element, worked out
+# from the timing the element promises rather than from its output:
+#
+#   - a dot is 6 * rate / (5 * wpm) samples, at least MIN_DOT_SAMPLES,
+#   - keyed runs are whole dots, gaps end on the exact dot grid,
+#   - an element is a 1 unit gap and a 1 or 3 unit key, a character is
+#     followed by MORSE_CHAR_GAP units, a space by MORSE_WORD_GAP and the
+#     message by MORSE_WORD_GAP + 1.
+#
+# Text is split like morse_table_next() does it, with the code table in
+# data/morse-table.txt. Regenerate after a deliberate change of timing or
+# of the table:
+#
+# usage: gen-morse-reference.py TABLE OUTPUT
+
+import sys
+
+MIN_DOT_SAMPLES = 100
+MORSE_CHAR_GAP = 1
+MORSE_WORD_GAP = 2
+PROSIGN_MAX = 8
+
+# format, rate, channels, wpm, text
+CASES = [
+    ('S16LE', 44100, 1, 20, 'PARIS PARIS'),
+    ('S16LE', 48000, 2, 20, 'CQ CQ DE VK3DG K'),
+    ('S16BE', 22050, 1, 25, 'paris 73'),
+    ('U16LE', 8000, 1, 30, 'SOS <SOS>'),
+    ('S24LE', 96000, 2, 15, '<CQ> <SK> <AR'),
+    ('S24_32BE', 44100, 8, 20, 'QRZ? 599 TU'),
+    ('U24LE', 16000, 1, 12, 'HI HI'),
+    ('S20LE', 32000, 1, 18, 'A1B2C3'),
+    ('U18BE', 44100, 2, 22, 'TEST\nTEST'),
+    ('S32LE', 192000, 1, 30, 'E T'),
+    ('U32BE', 11025, 1, 8, 'EE'),
+    ('F32LE', 44100, 1, 20, 'ÄRGER ÜBER ÖL'),
+    ('F32BE', 48000, 2, 28, 'café ñoño'),
+    ('F64LE', 8000, 1, 5, 'TE'),
+    ('F64BE', 96000, 1, 30, '?!.,/ =+-'),
+    ('S16LE', 44100, 1, 20, 'A # ~ B'),
+]
+
+
+def load_table(path):
+    chars = {}
+    prosigns = {}
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            key, code = line.split()
+            if len(key) > 2 and key[0] == '<' and key[-1] == '>':
+                prosigns[key[1:-1].upper()] = code
+            elif key.upper().startswith('U+') and len(key) > 2:
+                chars[int(key[2:], 16)] = code
+            else:
+                chars[ord(key.upper()) if len(key.upper()) == 1 else ord(key)] = code
+    return chars, prosigns
+
+
+# The codes and spaces of `text`, like morse_table_next()
+def tokens(text, chars, prosigns):
+    i = 0
+    while i < len(text):
+        ch = text[i]
+        if ord(ch) < 0x80:
+            i += 1
+            up = ord(ch.upper())
+            if up in chars:
+                yield chars[up]
+                continue
+            if ch == '<':
+                name = ''
+                j = i
+                while j < len(text) and len(name) < PROSIGN_MAX and \
+                        text[j].isascii() and text[j].isalnum():
+                    name += text[j].upper()
+                    j += 1
+                if name and j < len(text) and text[j] == '>' and name in prosigns:
+                    i = j + 1
+                    yield prosigns[name]
+                    continue
+            if ch in ' \t\n\v\f\r':
+                yield None
+            continue
+        i += 1
+        up = ord(ch.upper()) if len(ch.upper()) == 1 else ord(ch)
+        if up in chars:
+            yield chars[up]
+        elif ch.isspace():
+            yield None
+
+
+def runs(text, chars, prosigns):
+    for code in tokens(text, chars, prosigns):
+        if code is None:
+            yield (False, MORSE_WORD_GAP)
+            continue
+        for c in code:
+            yield (False, 1)
+            yield (True, 3 if c == '-' else 1)
+        yield (False, MORSE_CHAR_GAP)
+    yield (False, MORSE_WORD_GAP + 1)
+
+
+def render(rate, wpm, text, chars, prosigns):
+    num, den = 6 * rate, 5 * wpm
+    dot = num // den
+    if dot < MIN_DOT_SAMPLES:
+        dot, num, den = MIN_DOT_SAMPLES, MIN_DOT_SAMPLES, 1
+
+    t = played = 0
+    spans = []
+    for key, units in runs(text, chars, prosigns):
+        if key:
+            n = units * dot
+            spans.append((t, n))
+        else:
+            n = max((played + units) * num // den - t, 0)
+        t += n
+        played += units
+    return t, spans
+
+
+def escape(text):
+    out = ''
+    for b in text.encode('utf-8'):
+        if b in (0x5c, 0x22) or b < 0x20 or b > 0x7e:
+            out += '\\%03o' % b
+        else:
+            out += chr(b)
+    return out
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: gen-morse-reference.py TABLE OUTPUT')
+
+    chars, prosigns = load_table(sys.argv[1])
+    with open(sys.argv[2], 'w', encoding='utf-8') as out:
+        out.write('# Generated by tools/gen-morse-reference.py, do not edit.\n')
+        out.write('# format rate channels wpm text samples spans, tab '
+                  'separated. The text is\n# C escaped, spans are '
+                  'start+length of the keyed elements in samples.\n')
+        for fmt, rate, channels, wpm, text in CASES:
+            samples, spans = render(rate, wpm, text, chars, prosigns)
+            out.write('%s\t%d\t%d\t%d\t%s\t%d\t%s\n' % (
+                fmt, rate, channels, wpm, escape(text), samples,
+                ','.join('%d+%d' % s for s in spans)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+#
+# This file is part of [morsesrc].
+#
+# [morsesrc] is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# [morsesrc] is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+#
+# Turn a code table (see data/morse-table.txt) into the C initialisers of
+# the built-in table in src/gstmorsetable.c. The parser follows
+# morse_table_parse_line() so a file loaded at runtime means the same.
+#
+# usage: gen-morse-table.py INPUT OUTPUT
+
+import sys
+
+SYMBOL_MAX = 16   # MORSE_SYMBOL_MAX
+PROSIGN_MAX = 8   # MORSE_PROSIGN_MAX
+
+
+def parse_key(key):
+    if len(key) > 2 and key[0] == '<' and key[-1] == '>':
+        name = key[1:-1].upper()
+        if len(name) > PROSIGN_MAX or not name.isascii() or not name.isalnum():
+            return None
+        return ('prosign', name)
+    if key.upper().startswith('U+') and len(key) > 2:
+        try:
+            return ('char', int(key[2:], 16))
+        except ValueError:
+            return None
+    if len(key) == 1:
+        return ('char', ord(key.upper()) if len(key.upper()) == 1 else ord(key))
+    return None
+
+
+def parse_code(code):
+    if not 0 < len(code) <= SYMBOL_MAX or code.strip('.-'):
+        return None
+    bits = 0
+    for n, c in enumerate(code):
+        if c == '-':
+            bits |= 1 << n
+    return (bits, len(code))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: gen-morse-table.py INPUT OUTPUT')
+
+    chars = {}
+    prosigns = {}
+    with open(sys.argv[1], encoding='utf-8') as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            fields = line.split()
+            key = parse_key(fields[0]) if len(fields) == 2 else None
+            symbol = parse_code(fields[1]) if key else None
+            if not symbol:
+                sys.exit('%s:%d: bad entry "%s"' % (sys.argv[1], lineno, line))
+            if key[0] == 'prosign':
+                prosigns[key[1]] = symbol
+            else:
+                chars[key[1]] = symbol
+
+    # Lower case ASCII shares the upper case entries, the lookup folds the
+    # case of everything else
+    ascii = {}
+    for cp, symbol in chars.items():
+        if cp < 128:
+            ascii[cp] = symbol
+            if ord('A') <= cp <= ord('Z'):
+                ascii.setdefault(cp + 32, symbol)
+    others = sorted((cp, s) for cp, s in chars.items() if cp >= 128)
+
+    out = []
+    out.append('/* Generated by tools/gen-morse-table.py from %s, do not edit */'
+               % sys.argv[1].split('/')[-1])
+    out.append('')
+    out.append('static const MorseChar morse_builtin_chars[] = {')
+    for cp, (bits, length) in others:
+        out.append('  { 0x%04x, { 0x%04x, %d } },  /* %s */'
+                   % (cp, bits, length, chr(cp)))
+    out.append('};')
+    out.append('')
+    out.append('static const MorseProsign morse_builtin_prosigns[] = {')
+    for name, (bits, length) in sorted(prosigns.items()):
+        out.append('  { "%s", { 0x%04x, %d } },' % (name, bits, length))
+    out.append('};')
+    out.append('')
+    out.append('static MorseTable morse_builtin_table = {')
+    out.append('  -1, (gchar *) "builtin",')
+    out.append('  {')
+    for cp in sorted(ascii):
+        bits, length = ascii[cp]
+        glyph = chr(cp) if 32 < cp < 127 and chr(cp) not in '\\*/' else 'U+%04X' % cp
+        out.append('    [0x%02x] = { 0x%04x, %d },  /* %s */'
+                   % (cp, bits, length, glyph))
+    out.append('  },')
+    out.append('  G_N_ELEMENTS (morse_builtin_chars),')
+    out.append('  (MorseChar *) morse_builtin_chars,')
+    out.append('  G_N_ELEMENTS (morse_builtin_prosigns),')
+    out.append('  (MorseProsign *) morse_builtin_prosigns')
+    out.append('};')
+
+    with open(sys.argv[2], 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
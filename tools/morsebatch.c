@@ -0,0 +1,316 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Batch renderer for morsesrc. Reads a job list and renders every job to a
+  file as fast as the CPU allows, running one pipeline per job on a pool of
+  worker threads. Nothing syncs to a clock, so each pipeline renders faster
+  than realtime, and the pool keeps every core busy.
+
+  Each line of the job list is
+
+    <output file> TAB <text> [TAB <property>=<value>[,<property>=<value>...]]
+
+  Outputs ending in ".wav" go through wavenc, anything else is written raw.
+  The properties are applied to morsesrc and override the command line.
+  Empty lines and lines starting with '#' are skipped.
+
+  USAGE:
+  morsebatch --jobs=8 --rate=22050 --wpm=25 ids.txt
+  printf 'vk3dg.wav\tDE VK3DG\twpm=18,frequency=700\n' | morsebatch -
+*/
+
+#include <gst/gst.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+  gchar *output;
+  gchar *text;
+  gchar *properties;
+} BatchJob;
+
+typedef struct {
+  gint rate;
+  gint wpm;
+  gdouble frequency;
+  gdouble volume;
+  gchar *format;
+
+  GMutex lock;
+  guint done;
+  guint failed;
+  GstClockTime rendered;
+} BatchState;
+
+static void
+batch_job_free (BatchJob *job)
+{
+  g_free (job->output);
+  g_free (job->text);
+  g_free (job->properties);
+  g_free (job);
+}
+
+// Apply "name=value,name=value" to the source
+static gboolean
+batch_apply_properties (GstElement *src, const gchar *properties)
+{
+  gchar **pairs;
+  gboolean ok = TRUE;
+
+  if (!properties || !*properties)
+    return TRUE;
+
+  pairs = g_strsplit (properties, ",", -1);
+  for (gchar **p = pairs; *p; p++) {
+    gchar **kv = g_strsplit (g_strstrip (*p), "=", 2);
+
+    if (!kv[0] || !kv[1] ||
+        !g_object_class_find_property (G_OBJECT_GET_CLASS (src), kv[0])) {
+      g_printerr ("morsebatch: bad property \"%s\"\n", *p);
+      ok = FALSE;
+    } else {
+      gst_util_set_object_arg (G_OBJECT (src), kv[0], kv[1]);
+    }
+    g_strfreev (kv);
+  }
+  g_strfreev (pairs);
+
+  return ok;
+}
+
+// Render one job to completion. The source is asked for its duration at
+// EOS, which is the audio length this job contributes.
+static gboolean
+batch_render (BatchJob *job, BatchState *state, GstClockTime *rendered)
+{
+  GstElement *pipeline, *src, *filter, *enc = NULL, *sink;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  gboolean ok = FALSE;
+  gint64 duration = 0;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("morsesrc", NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  sink = gst_element_factory_make ("filesink", NULL);
+  if (g_str_has_suffix (job->output, ".wav"))
+    enc = gst_element_factory_make ("wavenc", NULL);
+
+  if (!src || !filter || !sink || (g_str_has_suffix (job->output, ".wav") &&
+          !enc)) {
+    g_printerr ("morsebatch: missing element, is GST_PLUGIN_PATH set?\n");
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  // Fastest path: pre-rendered dits/dahs and the best kernels available
+  g_object_set (src, "text", job->text, "wpm", state->wpm,
+      "frequency", state->frequency, "volume", state->volume,
+      "symbol-cache", TRUE, NULL);
+  if (!batch_apply_properties (src, job->properties)) {
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, state->format,
+      "rate", G_TYPE_INT, state->rate,
+      "channels", G_TYPE_INT, 1, NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (sink, "location", job->output, "sync", FALSE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, sink, NULL);
+  if (enc) {
+    gst_bin_add (GST_BIN (pipeline), enc);
+    ok = gst_element_link_many (src, filter, enc, sink, NULL);
+  } else {
+    ok = gst_element_link_many (src, filter, sink, NULL);
+  }
+
+  if (!ok) {
+    g_printerr ("morsebatch: %s: could not link pipeline\n", job->output);
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  ok = msg && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (!ok && msg) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("morsebatch: %s: %s\n", job->output, err->message);
+    g_error_free (err);
+  }
+
+  if (ok && gst_element_query_duration (src, GST_FORMAT_TIME, &duration))
+    *rendered = duration;
+
+  if (msg)
+    gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ok;
+}
+
+static void
+batch_worker (gpointer data, gpointer user_data)
+{
+  BatchJob *job = data;
+  BatchState *state = user_data;
+  GstClockTime rendered = 0;
+  gboolean ok;
+
+  ok = batch_render (job, state, &rendered);
+
+  g_mutex_lock (&state->lock);
+  state->done++;
+  if (ok)
+    state->rendered += rendered;
+  else
+    state->failed++;
+  g_mutex_unlock (&state->lock);
+
+  batch_job_free (job);
+}
+
+static BatchJob *
+batch_parse_line (gchar *line)
+{
+  gchar **fields;
+  BatchJob *job = NULL;
+
+  g_strchomp (line);
+  if (!*line || *line == '#')
+    return NULL;
+
+  fields = g_strsplit (line, "\t", 3);
+  if (fields[0] && fields[1] && *fields[0] && *fields[1]) {
+    job = g_new0 (BatchJob, 1);
+    job->output = g_strdup (fields[0]);
+    job->text = g_strdup (fields[1]);
+    job->properties = g_strdup (fields[2]);
+  } else {
+    g_printerr ("morsebatch: skipping malformed line \"%s\"\n", line);
+  }
+  g_strfreev (fields);
+
+  return job;
+}
+
+int
+main (int argc, char *argv[])
+{
+  BatchState state = { 0 };
+  gint jobs = 0;
+  gchar *format = NULL;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GThreadPool *pool;
+  FILE *list;
+  gchar *line = NULL;
+  size_t line_size = 0;
+  gint64 start, elapsed;
+  guint queued = 0;
+
+  state.rate = 44100;
+  state.wpm = 20;
+  state.frequency = 880.0;
+  state.volume = 0.5;
+
+  GOptionEntry entries[] = {
+    {"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+        "Pipelines rendering at once (default: one per core)", "N"},
+    {"rate", 'r', 0, G_OPTION_ARG_INT, &state.rate,
+        "Sample rate (default: 44100)", "HZ"},
+    {"wpm", 'w', 0, G_OPTION_ARG_INT, &state.wpm,
+        "Words per minute (default: 20)", "WPM"},
+    {"frequency", 'f', 0, G_OPTION_ARG_DOUBLE, &state.frequency,
+        "Tone frequency in Hz (default: 880)", "HZ"},
+    {"volume", 'v', 0, G_OPTION_ARG_DOUBLE, &state.volume,
+        "Volume 0.0-1.0 (default: 0.5)", "VOL"},
+    {"format", 0, 0, G_OPTION_ARG_STRING, &format,
+        "Sample format (default: S16LE)", "FORMAT"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new ("JOBLIST - render morse jobs to files");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("morsebatch: %s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2) {
+    g_printerr ("usage: morsebatch [OPTION...] JOBLIST (or - for stdin)\n");
+    return 1;
+  }
+
+  if (jobs <= 0)
+    jobs = g_get_num_processors ();
+  state.format = format ? format : g_strdup ("S16LE");
+  g_mutex_init (&state.lock);
+
+  list = strcmp (argv[1], "-") == 0 ? stdin : fopen (argv[1], "r");
+  if (!list) {
+    g_printerr ("morsebatch: cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  pool = g_thread_pool_new (batch_worker, &state, jobs, TRUE, NULL);
+  start = g_get_monotonic_time ();
+
+  // Lines are read whole, a bulletin may be longer than any fixed buffer
+  while (getline (&line, &line_size, list) >= 0) {
+    BatchJob *job = batch_parse_line (line);
+
+    if (job && g_thread_pool_push (pool, job, NULL))
+      queued++;
+  }
+  free (line);
+  if (list != stdin)
+    fclose (list);
+
+  // Waits for every queued job to finish
+  g_thread_pool_free (pool, FALSE, TRUE);
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%u jobs, %u failed, %.1f s of audio in %.2f s on %d workers, "
+      "%.1fx realtime\n", state.done, state.failed,
+      (gdouble) state.rendered / GST_SECOND, elapsed / 1e6, jobs,
+      elapsed > 0 ? ((gdouble) state.rendered / GST_USECOND) / elapsed : 0.0);
+
+  g_mutex_clear (&state.lock);
+  g_free (state.format);
+
+  return state.failed > 0 || queued == 0;
+}
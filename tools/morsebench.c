@@ -0,0 +1,971 @@
+/*
+  This file is part of [morsesrc].
+
+  [morsesrc] is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  [morsesrc] is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with [morsesrc]. If not, see <https://www.gnu.org/licenses/>.
+
+  DESCRIPTION:
+  Throughput benchmark for morsesrc. Every case renders the same amount of
+  audio and reports samples per second, nanoseconds per sample, allocations
+  per buffer and the realtime factor, one CSV line (or JSON object) per case
+  so runs can be compared with a script.
+
+  By default the element's start/set_caps/create functions are called
+  directly, so nothing but the generators and create() is measured. With
+  --pipeline each case runs as morsesrc ! fakesink sync=false instead, which
+  adds pool negotiation and buffer recycling.
+
+  The matrix covers every format in the source pad template, 1/2/8
+  channels, 8-192 kHz and 5-30 WPM. Each dimension can be narrowed with a
+  comma separated list, --quick picks a small matrix for regular runs.
+
+  With --verify nothing is timed. Every case is compared sample by sample
+  against the reference generator (sin, no SIMD, no symbol cache) in the
+  same format, and fails when they differ by more than --tolerance of full
+  scale plus one step of the format. Faster oscillators, kernels and
+  caches must pass it before they are trusted. --tolerance=0 asks for
+  bit-exact output, which the SIMD kernels promise. With --seek the case
+  seeks that far in first and must match the rest of the reference from
+  there, tone phase included. --high-speed runs every case with the
+  "high-speed" property set, on its exact dot grid.
+
+  With --stress every case runs with random property changes between
+  buffers: texts of random ASCII, UTF-8, broken UTF-8 and half prosigns,
+  and random speeds, tones and buffer sizes. Each buffer is checked to
+  hold whole frames and to carry on from the last one. --seed repeats a
+  failing run.
+
+  With --reference the cases come from a corpus file instead, by default
+  tests/morse-reference.txt as written by tools/gen-morse-reference.py from
+  the timing the element promises. Each case must render exactly the
+  expected number of samples, silence outside the keyed spans and a tone
+  of the set volume and frequency inside them, for every oscillator, kernel
+  and cache setting given.
+
+  USAGE:
+  morsebench --quick
+  morsebench --formats=S16LE,F32LE --oscillator=sin,wavetable,recursive --simd=none,auto --json
+  morsebench --quick --verify --oscillator=wavetable,recursive --simd=auto --symbol-cache=false,true
+  morsebench --verify --simd=sse2,avx2,neon --tolerance=0 --rates=44100 --seconds=2
+  morsebench --verify --high-speed --wpm=250,999 --seek=1234 --seconds=2
+  morsebench --quick --stress --seed=1234
+  morsebench --reference=tests/morse-reference.txt --oscillator=sin,wavetable --simd=none,auto
+*/
+
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#include <gst/audio/audio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Level and tone every case renders at, the element's defaults
+#define BENCH_VOLUME 0.5
+#define BENCH_FREQUENCY 880.0
+
+typedef struct {
+  const gchar *oscillator;
+  const gchar *simd;
+  const gchar *symbol_cache;
+  const gchar *format;
+  gint channels;
+  gint rate;
+  gint wpm;
+  const gchar *text;            // NULL for PARIS over and over
+  gboolean high_speed;
+  GstClockTime seek;            // First buffer of --verify, 0 for none
+} BenchCase;
+
+// A case of the --reference corpus: the samples the text takes and the
+// start and length of every keyed element, in pairs
+typedef struct {
+  BenchCase c;
+  guint64 samples;
+  GArray *spans;
+} BenchReference;
+
+typedef struct {
+  guint64 buffers;
+  guint64 samples;
+  guint64 allocations;
+  gint64 elapsed;
+} BenchResult;
+
+// Characters --stress builds its texts from, one UTF-8 sequence each.
+// "\xc3" and "\xe2\x82" are cut short, "\xff" is never valid.
+static const gchar *stress_chars[] = {
+  "A", "E", "T", "0", "5", "?", "/", " ", " ", "\n", "\t", "<", ">",
+  "<SK>", "<AR", "SK>", "<>", "\xc3\x84", "\xd0\x96", "\xe2\x82\xac",
+  "\xc3", "\xe2\x82", "\xff", "\x7f", "\x01"
+};
+
+// Split a comma separated option, `fallback` when it was not given
+static gchar **
+bench_list (const gchar *option, const gchar *fallback)
+{
+  return g_strsplit (option ? option : fallback, ",", -1);
+}
+
+// Every format the source pad template offers
+static gchar **
+bench_template_formats (void)
+{
+  GstElementFactory *factory = gst_element_factory_find ("morsesrc");
+  GPtrArray *formats = g_ptr_array_new ();
+  const GList *templates;
+
+  if (!factory)
+    return NULL;
+
+  templates = gst_element_factory_get_static_pad_templates (factory);
+  for (; templates; templates = templates->next) {
+    GstStaticPadTemplate *templ = templates->data;
+    GstCaps *caps;
+    const GValue *list;
+
+    if (templ->direction != GST_PAD_SRC)
+      continue;
+
+    caps = gst_static_pad_template_get_caps (templ);
+    list = gst_structure_get_value (gst_caps_get_structure (caps, 0),
+        "format");
+    for (guint i = 0; list && i < gst_value_list_get_size (list); i++)
+      g_ptr_array_add (formats,
+          g_value_dup_string (gst_value_list_get_value (list, i)));
+    gst_caps_unref (caps);
+  }
+  gst_object_unref (factory);
+
+  g_ptr_array_add (formats, NULL);
+  return (gchar **) g_ptr_array_free (formats, FALSE);
+}
+
+static GstCaps *
+bench_caps (const BenchCase *c)
+{
+  GstCaps *caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, c->format,
+      "rate", G_TYPE_INT, c->rate,
+      "channels", G_TYPE_INT, c->channels,
+      "layout", G_TYPE_STRING, "interleaved", NULL);
+
+  if (c->channels > 2)
+    gst_caps_set_simple (caps, "channel-mask", GST_TYPE_BITMASK, 0ULL, NULL);
+  return caps;
+}
+
+// A source for the case keying its text, or about `seconds` of audio with
+// PARIS being the standard 50 unit word
+static GstElement *
+bench_source (const BenchCase *c, guint seconds)
+{
+  GstElement *src = gst_element_factory_make ("morsesrc", NULL);
+  GString *text = g_string_new (c->text);
+  guint words = c->text ? 0 : seconds * c->wpm / 60 + 1;
+
+  if (!src)
+    return NULL;
+
+  for (guint i = 0; i < words; i++)
+    g_string_append (text, "PARIS ");
+
+  // Before "wpm", which it raises the limit of
+  g_object_set (src, "high-speed", c->high_speed, NULL);
+  g_object_set (src, "text", text->str, "wpm", c->wpm,
+      "volume", BENCH_VOLUME, "frequency", BENCH_FREQUENCY, NULL);
+  gst_util_set_object_arg (G_OBJECT (src), "oscillator", c->oscillator);
+  gst_util_set_object_arg (G_OBJECT (src), "simd", c->simd);
+  gst_util_set_object_arg (G_OBJECT (src), "symbol-cache", c->symbol_cache);
+  g_string_free (text, TRUE);
+
+  return src;
+}
+
+// Drive create() by hand until EOS, keeping the audio in `capture` when
+// it is not NULL
+static gboolean
+bench_run_create (const BenchCase *c, guint seconds, BenchResult *r,
+    GByteArray *capture)
+{
+  GstElement *element = bench_source (c, seconds);
+  GstBaseSrcClass *bclass;
+  GstPushSrcClass *pclass;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstAudioInfo info;
+  GstCaps *caps;
+  guint64 allocations = 0;
+  gint64 start;
+  gboolean ok;
+
+  if (!element)
+    return FALSE;
+
+  bclass = GST_BASE_SRC_GET_CLASS (element);
+  pclass = GST_PUSH_SRC_GET_CLASS (element);
+  caps = bench_caps (c);
+  gst_audio_info_from_caps (&info, caps);
+
+  ok = bclass->start (GST_BASE_SRC (element)) &&
+      bclass->set_caps (GST_BASE_SRC (element), caps);
+  gst_caps_unref (caps);
+
+  if (ok && c->seek > 0) {
+    GstSegment segment;
+
+    gst_segment_init (&segment, GST_FORMAT_TIME);
+    segment.start = c->seek;
+    ok = bclass->is_seekable (GST_BASE_SRC (element)) &&
+        bclass->do_seek (GST_BASE_SRC (element), &segment);
+  }
+
+  if (ok) {
+    g_object_get (element, "allocations", &allocations, NULL);
+    start = g_get_monotonic_time ();
+
+    while (ret == GST_FLOW_OK) {
+      GstBuffer *buf = NULL;
+
+      ret = pclass->create (GST_PUSH_SRC (element), &buf);
+      if (ret != GST_FLOW_OK)
+        break;
+      r->buffers++;
+      r->samples += gst_buffer_get_size (buf) / GST_AUDIO_INFO_BPF (&info);
+      if (capture) {
+        GstMapInfo map;
+
+        gst_buffer_map (buf, &map, GST_MAP_READ);
+        g_byte_array_append (capture, map.data, map.size);
+        gst_buffer_unmap (buf, &map);
+      }
+      gst_buffer_unref (buf);
+    }
+
+    r->elapsed = g_get_monotonic_time () - start;
+    g_object_get (element, "allocations", &r->allocations, NULL);
+    r->allocations -= allocations;
+    bclass->stop (GST_BASE_SRC (element));
+    ok = ret == GST_FLOW_EOS;
+  }
+
+  gst_object_unref (element);
+  return ok;
+}
+
+static void
+bench_handoff (GstElement *sink, GstBuffer *buf, GstPad *pad,
+    gpointer user_data)
+{
+  BenchResult *r = user_data;
+
+  r->buffers++;
+  r->samples += GST_BUFFER_OFFSET_END (buf) - GST_BUFFER_OFFSET (buf);
+}
+
+// Run the case through a real pipeline with a non-syncing fakesink
+static gboolean
+bench_run_pipeline (const BenchCase *c, guint seconds, BenchResult *r)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *src = bench_source (c, seconds);
+  GstElement *filter = gst_element_factory_make ("capsfilter", NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  gint64 start;
+  gboolean ok;
+
+  if (!src || !filter || !sink) {
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  caps = bench_caps (c);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (bench_handoff), r);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, sink, NULL);
+  if (!gst_element_link_many (src, filter, sink, NULL)) {
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  r->elapsed = g_get_monotonic_time () - start;
+  ok = msg && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  g_object_get (src, "allocations", &r->allocations, NULL);
+
+  if (msg)
+    gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ok;
+}
+
+// Samples in `data` as a fraction of full scale. Every format unpacks to
+// S32 or F64.
+static gdouble *
+bench_unpack (const GstAudioFormatInfo *finfo, const GByteArray *data,
+    gint bpf, gint channels, gsize *n)
+{
+  gint length = data->len / bpf * channels;
+  gdouble *out = g_new (gdouble, MAX (length, 1));
+
+  if (GST_AUDIO_FORMAT_INFO_IS_FLOAT (
+          gst_audio_format_get_info (finfo->unpack_format))) {
+    finfo->unpack_func (finfo, 0, out, data->data, length);
+  } else {
+    gint32 *tmp = g_new (gint32, MAX (length, 1));
+
+    finfo->unpack_func (finfo, 0, tmp, data->data, length);
+    for (gint k = 0; k < length; k++)
+      out[k] = tmp[k] / 2147483648.0;
+    g_free (tmp);
+  }
+
+  *n = length;
+  return out;
+}
+
+// Render the case and the reference generator in the same format, the
+// reference from the start and the case from its seek target. The largest
+// difference goes to `max_error`, negative when the lengths differ.
+static gboolean
+bench_run_verify (const BenchCase *c, guint seconds, BenchResult *r,
+    gdouble *max_error)
+{
+  BenchCase ref = { "sin", "none", "false", c->format, c->channels, c->rate,
+    c->wpm, c->text, c->high_speed, 0 };
+  BenchResult ref_result = { 0 };
+  GByteArray *got = g_byte_array_new (), *want = g_byte_array_new ();
+  const GstAudioFormatInfo *finfo =
+      gst_audio_format_get_info (gst_audio_format_from_string (c->format));
+  gboolean ok = finfo && finfo->unpack_func &&
+      bench_run_create (c, seconds, r, got) &&
+      bench_run_create (&ref, seconds, &ref_result, want);
+  gint bpf = finfo ? GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8 * c->channels : 0;
+  guint64 skip = gst_util_uint64_scale (c->seek, c->rate, GST_SECOND) * bpf;
+
+  // The case starts at the seek target
+  if (ok)
+    g_byte_array_remove_range (want, 0, MIN (skip, want->len));
+
+  *max_error = -1.0;
+  if (ok && got->len == want->len) {
+    gsize n;
+    gdouble *a = bench_unpack (finfo, got, bpf, c->channels, &n);
+    gdouble *b = bench_unpack (finfo, want, bpf, c->channels, &n);
+
+    *max_error = 0.0;
+    for (gsize k = 0; k < n; k++)
+      *max_error = MAX (*max_error, fabs (a[k] - b[k]));
+    g_free (a);
+    g_free (b);
+  }
+
+  g_byte_array_unref (got);
+  g_byte_array_unref (want);
+  return ok;
+}
+
+static void
+bench_reference_free (gpointer data)
+{
+  BenchReference *ref = data;
+
+  g_free ((gchar *) ref->c.format);
+  g_free ((gchar *) ref->c.text);
+  g_array_unref (ref->spans);
+  g_free (ref);
+}
+
+// Read the corpus at `path`: format, rate, channels, wpm, C escaped text,
+// samples and start+length spans, tab separated. NULL with a message when
+// a line does not parse.
+static GPtrArray *
+bench_reference_load (const gchar *path)
+{
+  GPtrArray *refs = g_ptr_array_new_with_free_func (bench_reference_free);
+  GError *err = NULL;
+  gchar *contents, **lines;
+  guint lineno = 0;
+
+  if (!g_file_get_contents (path, &contents, NULL, &err)) {
+    g_printerr ("morsebench: %s\n", err->message);
+    g_error_free (err);
+    g_ptr_array_unref (refs);
+    return NULL;
+  }
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (gchar **line = lines; *line && refs; line++) {
+    gchar **fields = g_strsplit (*line, "\t", -1);
+    BenchReference *ref;
+
+    lineno++;
+    if (**line == '\0' || **line == '#') {
+      g_strfreev (fields);
+      continue;
+    }
+    if (g_strv_length (fields) != 7) {
+      g_printerr ("morsebench: %s:%u: expected 7 fields\n", path, lineno);
+      g_strfreev (fields);
+      g_clear_pointer (&refs, g_ptr_array_unref);
+      break;
+    }
+
+    ref = g_new0 (BenchReference, 1);
+    ref->c.format = g_strdup (fields[0]);
+    ref->c.rate = atoi (fields[1]);
+    ref->c.channels = atoi (fields[2]);
+    ref->c.wpm = atoi (fields[3]);
+    ref->c.text = g_strcompress (fields[4]);
+    ref->samples = g_ascii_strtoull (fields[5], NULL, 10);
+    ref->spans = g_array_new (FALSE, FALSE, sizeof (guint64));
+    g_ptr_array_add (refs, ref);
+
+    for (gchar *p = fields[6]; *p; p += *p == ',') {
+      guint64 span[2];
+
+      span[0] = g_ascii_strtoull (p, &p, 10);
+      span[1] = *p == '+' ? g_ascii_strtoull (p + 1, &p, 10) : 0;
+      if (span[1] == 0 || (*p && *p != ',')) {
+        g_printerr ("morsebench: %s:%u: bad span\n", path, lineno);
+        g_clear_pointer (&refs, g_ptr_array_unref);
+        break;
+      }
+      g_array_append_vals (ref->spans, span, 2);
+    }
+    g_strfreev (fields);
+  }
+
+  g_strfreev (lines);
+  return refs;
+}
+
+// Sign changes in channel 0 of the frames [start, start + n)
+static guint
+bench_zero_crossings (const gdouble *x, gint channels, guint64 start,
+    guint64 n)
+{
+  guint crossings = 0;
+  gdouble last = 0.0;
+
+  for (guint64 k = start; k < start + n; k++) {
+    gdouble v = x[k * channels];
+
+    if (v != 0.0) {
+      if (last != 0.0 && (v > 0.0) != (last > 0.0))
+        crossings++;
+      last = v;
+    }
+  }
+  return crossings;
+}
+
+// Render the corpus case with the engine settings of `c` and check it
+// against the expected timing. What did not match goes to `why`, NULL when
+// it all did.
+static gboolean
+bench_run_reference (const BenchCase *c, const BenchReference *ref,
+    gdouble allowed, BenchResult *r, gchar **why)
+{
+  GByteArray *got = g_byte_array_new ();
+  const GstAudioFormatInfo *finfo =
+      gst_audio_format_get_info (gst_audio_format_from_string (c->format));
+  gboolean ok = finfo && finfo->unpack_func &&
+      bench_run_create (c, 0, r, got);
+  const guint64 *spans = (const guint64 *) ref->spans->data;
+  guint n_spans = ref->spans->len / 2;
+  guint64 frame = 0;
+  gdouble *x;
+  gsize n;
+
+  *why = NULL;
+  if (!ok) {
+    g_byte_array_unref (got);
+    return FALSE;
+  }
+  if (r->samples != ref->samples) {
+    *why = g_strdup_printf ("%" G_GUINT64_FORMAT " samples, expected %"
+        G_GUINT64_FORMAT, r->samples, ref->samples);
+    g_byte_array_unref (got);
+    return TRUE;
+  }
+
+  x = bench_unpack (finfo, got,
+      GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8 * c->channels, c->channels, &n);
+
+  for (guint i = 0; i <= n_spans && !*why; i++) {
+    guint64 start = i < n_spans ? spans[2 * i] : ref->samples;
+    guint64 length = i < n_spans ? spans[2 * i + 1] : 0;
+    gdouble peak = 0.0, cycles;
+    guint crossings;
+
+    for (; frame < start && !*why; frame++)
+      for (gint ch = 0; ch < c->channels; ch++)
+        if (x[frame * c->channels + ch] != 0.0)
+          *why = g_strdup_printf ("sample %" G_GUINT64_FORMAT " is %g in "
+              "a gap", frame, x[frame * c->channels + ch]);
+    if (*why || i == n_spans)
+      break;
+
+    for (; frame < start + length; frame++)
+      for (gint ch = 0; ch < c->channels; ch++)
+        peak = MAX (peak, fabs (x[frame * c->channels + ch]));
+    cycles = 2.0 * BENCH_FREQUENCY * length / c->rate;
+    crossings = bench_zero_crossings (x, c->channels, start, length);
+
+    if (peak < 0.8 * BENCH_VOLUME || peak > BENCH_VOLUME + allowed)
+      *why = g_strdup_printf ("element at %" G_GUINT64_FORMAT " peaks at "
+          "%g", start, peak);
+    else if (fabs (crossings - cycles) > MAX (4.0, 0.05 * cycles))
+      *why = g_strdup_printf ("element at %" G_GUINT64_FORMAT " crosses "
+          "zero %u times, expected %.0f", start, crossings, cycles);
+  }
+
+  g_free (x);
+  g_byte_array_unref (got);
+  return TRUE;
+}
+
+// Text of up to 48 characters from `stress_chars`
+static gchar *
+bench_stress_text (GRand *rand)
+{
+  GString *text = g_string_new (NULL);
+  gint length = g_rand_int_range (rand, 0, 49);
+
+  for (gint k = 0; k < length; k++)
+    g_string_append (text,
+        stress_chars[g_rand_int_range (rand, 0, G_N_ELEMENTS (stress_chars))]);
+  return g_string_free (text, FALSE);
+}
+
+// Returns TRUE when a new text was set, which starts over at sample 0
+static gboolean
+bench_stress_change (GstElement *element, GRand *rand)
+{
+  gboolean restart = FALSE;
+  gint wpm;
+
+  switch (g_rand_int_range (rand, 0, 6)) {
+    case 0:
+      {
+        gchar *text = bench_stress_text (rand);
+
+        // Empty texts are ignored
+        g_object_set (element, "text", text, NULL);
+        restart = text[0] != '\0';
+        g_free (text);
+        break;
+      }
+    case 1:
+      g_object_set (element, "wpm", g_rand_int_range (rand, 5, 31), NULL);
+      break;
+    case 2:
+      g_object_set (element, "frequency",
+          g_rand_double_range (rand, 400.0, 2000.0), NULL);
+      break;
+    case 3:
+      g_object_set (element, "volume", g_rand_double (rand), NULL);
+      break;
+    case 4:
+      // Mostly small, so elements are split across buffers
+      g_object_set (element, "samples-per-buffer", g_rand_boolean (rand)
+          ? g_rand_int_range (rand, 1, 64)
+          : g_rand_int_range (rand, 64, 16384), NULL);
+      break;
+    default:
+      g_object_get (element, "wpm", &wpm, NULL);
+      g_object_set (element, "farnsworth-wpm", g_rand_boolean (rand)
+          ? 0 : g_rand_int_range (rand, 5, wpm + 1), NULL);
+      break;
+  }
+
+  return restart;
+}
+
+// Drive create() under random property changes for `seconds` of audio.
+// A new text starts over at sample 0 once it is applied, at an element
+// boundary some buffers later, anything else must carry on.
+static gboolean
+bench_run_stress (const BenchCase *c, guint seconds, guint32 seed,
+    BenchResult *r)
+{
+  GstElement *element = bench_source (c, seconds);
+  GstBaseSrcClass *bclass;
+  GstPushSrcClass *pclass;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstAudioInfo info;
+  GstCaps *caps;
+  GRand *rand;
+  guint64 offset = 0, total;
+  guint eos = 0;
+  gboolean restart = FALSE;
+  gint64 start;
+  gboolean ok;
+
+  if (!element)
+    return FALSE;
+
+  bclass = GST_BASE_SRC_GET_CLASS (element);
+  pclass = GST_PUSH_SRC_GET_CLASS (element);
+  caps = bench_caps (c);
+  gst_audio_info_from_caps (&info, caps);
+  total = (guint64) seconds * c->rate;
+  rand = g_rand_new_with_seed (seed);
+
+  ok = bclass->start (GST_BASE_SRC (element)) &&
+      bclass->set_caps (GST_BASE_SRC (element), caps);
+  gst_caps_unref (caps);
+
+  start = g_get_monotonic_time ();
+  while (ok && r->samples < total) {
+    GstBuffer *buf = NULL;
+    gsize size;
+
+    if (g_rand_int_range (rand, 0, 4) == 0 &&
+        bench_stress_change (element, rand))
+      restart = TRUE;
+
+    ret = pclass->create (GST_PUSH_SRC (element), &buf);
+    if (ret == GST_FLOW_EOS && eos++ == 0) {
+      // Ran out of text, give it more
+      g_object_set (element, "text", "PARIS ", NULL);
+      restart = TRUE;
+      continue;
+    }
+    if (ret != GST_FLOW_OK) {
+      g_printerr ("morsebench: create returned %s after %" G_GUINT64_FORMAT
+          " buffers\n", gst_flow_get_name (ret), r->buffers);
+      ok = FALSE;
+      break;
+    }
+
+    eos = 0;
+    size = gst_buffer_get_size (buf);
+    if (size % GST_AUDIO_INFO_BPF (&info) != 0 ||
+        GST_BUFFER_OFFSET_END (buf) - GST_BUFFER_OFFSET (buf) !=
+        size / GST_AUDIO_INFO_BPF (&info) ||
+        (GST_BUFFER_OFFSET (buf) != offset &&
+            (GST_BUFFER_OFFSET (buf) != 0 || !restart))) {
+      g_printerr ("morsebench: buffer %" G_GUINT64_FORMAT " of %"
+          G_GSIZE_FORMAT " bytes at %" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT
+          ", expected %" G_GUINT64_FORMAT "\n", r->buffers, size,
+          GST_BUFFER_OFFSET (buf), GST_BUFFER_OFFSET_END (buf), offset);
+      ok = FALSE;
+    }
+
+    if (GST_BUFFER_OFFSET (buf) != offset)
+      restart = FALSE;
+    offset = GST_BUFFER_OFFSET_END (buf);
+    r->buffers++;
+    r->samples += size / GST_AUDIO_INFO_BPF (&info);
+    gst_buffer_unref (buf);
+  }
+  r->elapsed = g_get_monotonic_time () - start;
+
+  bclass->stop (GST_BASE_SRC (element));
+  g_rand_free (rand);
+  gst_object_unref (element);
+  return ok;
+}
+
+static void
+bench_report (const BenchCase *c, const BenchResult *r, const gchar *mode,
+    gboolean json)
+{
+  gdouble seconds = r->elapsed / 1e6;
+  gdouble rate = seconds > 0 ? r->samples / seconds : 0.0;
+  gdouble ns = r->samples > 0 ? r->elapsed * 1e3 / r->samples : 0.0;
+  gdouble allocs = r->buffers > 0 ? (gdouble) r->allocations / r->buffers : 0.0;
+  gdouble realtime = seconds > 0 ? r->samples / (gdouble) c->rate / seconds : 0.0;
+
+  if (json)
+    g_print ("{\"mode\":\"%s\",\"oscillator\":\"%s\",\"simd\":\"%s\","
+        "\"symbol_cache\":%s,\"format\":\"%s\",\"channels\":%d,\"rate\":%d,"
+        "\"wpm\":%d,\"buffers\":%" G_GUINT64_FORMAT ",\"samples\":%"
+        G_GUINT64_FORMAT ",\"seconds\":%.6f,\"samples_per_sec\":%.0f,"
+        "\"ns_per_sample\":%.3f,\"allocs_per_buffer\":%.4f,"
+        "\"realtime\":%.1f}\n", mode, c->oscillator, c->simd,
+        c->symbol_cache, c->format, c->channels, c->rate, c->wpm,
+        r->buffers, r->samples, seconds, rate, ns, allocs, realtime);
+  else
+    g_print ("%s,%s,%s,%s,%s,%d,%d,%d,%" G_GUINT64_FORMAT ",%"
+        G_GUINT64_FORMAT ",%.6f,%.0f,%.3f,%.4f,%.1f\n", mode,
+        c->oscillator, c->simd, c->symbol_cache, c->format, c->channels,
+        c->rate, c->wpm, r->buffers, r->samples, seconds, rate, ns, allocs,
+        realtime);
+}
+
+// Outcome of --verify, the error and what was allowed as fractions of full
+// scale
+static void
+bench_report_verify (const BenchCase *c, const BenchResult *r,
+    gdouble error, gdouble allowed, gboolean json)
+{
+  const gchar *result = error >= 0.0 && error <= allowed ? "pass" : "fail";
+
+  if (json)
+    g_print ("{\"mode\":\"verify\",\"oscillator\":\"%s\",\"simd\":\"%s\","
+        "\"symbol_cache\":%s,\"format\":\"%s\",\"channels\":%d,\"rate\":%d,"
+        "\"wpm\":%d,\"samples\":%" G_GUINT64_FORMAT ",\"max_error\":%.3g,"
+        "\"allowed\":%.3g,\"result\":\"%s\"}\n", c->oscillator, c->simd,
+        c->symbol_cache, c->format, c->channels, c->rate, c->wpm, r->samples,
+        error, allowed, result);
+  else
+    g_print ("verify,%s,%s,%s,%s,%d,%d,%d,%" G_GUINT64_FORMAT ",%.3g,%.3g,%s\n",
+        c->oscillator, c->simd, c->symbol_cache, c->format, c->channels,
+        c->rate, c->wpm, r->samples, error, allowed, result);
+}
+
+static void
+bench_report_reference (const BenchCase *c, const BenchResult *r,
+    const gchar *why, gboolean json)
+{
+  const gchar *result = why ? "fail" : "pass";
+
+  if (json)
+    g_print ("{\"mode\":\"reference\",\"oscillator\":\"%s\",\"simd\":\"%s\","
+        "\"symbol_cache\":%s,\"format\":\"%s\",\"channels\":%d,\"rate\":%d,"
+        "\"wpm\":%d,\"samples\":%" G_GUINT64_FORMAT ",\"result\":\"%s\"}\n",
+        c->oscillator, c->simd, c->symbol_cache, c->format, c->channels,
+        c->rate, c->wpm, r->samples, result);
+  else
+    g_print ("reference,%s,%s,%s,%s,%d,%d,%d,%" G_GUINT64_FORMAT ",%s\n",
+        c->oscillator, c->simd, c->symbol_cache, c->format, c->channels,
+        c->rate, c->wpm, r->samples, result);
+  if (why)
+    g_printerr ("morsebench: %s\n", why);
+}
+
+// Step of the integer formats on top of `tolerance`, as a fraction of full
+// scale. A tolerance of 0 asks for bit-exact output.
+static gdouble
+bench_allowed (const gchar *format, gdouble tolerance)
+{
+  const GstAudioFormatInfo *finfo =
+      gst_audio_format_get_info (gst_audio_format_from_string (format));
+
+  if (tolerance > 0.0 && finfo && GST_AUDIO_FORMAT_INFO_IS_INTEGER (finfo))
+    tolerance += ldexp (1.0, 1 - GST_AUDIO_FORMAT_INFO_DEPTH (finfo));
+  return tolerance;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *formats_opt = NULL, *channels_opt = NULL, *rates_opt = NULL;
+  gchar *wpm_opt = NULL, *oscillator_opt = NULL, *simd_opt = NULL;
+  gchar *cache_opt = NULL, *reference_opt = NULL;
+  gint seconds = 10;
+  gdouble tolerance = 1e-4;
+  gint seed = 0, seek = 0;
+  gboolean pipeline = FALSE, json = FALSE, quick = FALSE;
+  gboolean verify = FALSE, stress = FALSE, high_speed = FALSE;
+  gchar **formats, **channels, **rates, **wpms, **oscillators, **simds;
+  gchar **caches;
+  GPtrArray *refs = NULL;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint failed = 0;
+
+  GOptionEntry entries[] = {
+    {"formats", 0, 0, G_OPTION_ARG_STRING, &formats_opt,
+        "Sample formats (default: every template format)", "LIST"},
+    {"channels", 0, 0, G_OPTION_ARG_STRING, &channels_opt,
+        "Channel counts (default: 1,2,8)", "LIST"},
+    {"rates", 0, 0, G_OPTION_ARG_STRING, &rates_opt,
+        "Sample rates (default: 8000,22050,44100,48000,96000,192000)", "LIST"},
+    {"wpm", 0, 0, G_OPTION_ARG_STRING, &wpm_opt,
+        "Speeds (default: 5,20,30)", "LIST"},
+    {"oscillator", 0, 0, G_OPTION_ARG_STRING, &oscillator_opt,
+        "Tone engines (default: sin)", "LIST"},
+    {"simd", 0, 0, G_OPTION_ARG_STRING, &simd_opt,
+        "Sample kernels (default: auto)", "LIST"},
+    {"symbol-cache", 0, 0, G_OPTION_ARG_STRING, &cache_opt,
+        "Symbol cache settings (default: false)", "LIST"},
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &seconds,
+        "Audio rendered per case (default: 10)", "S"},
+    {"pipeline", 'p', 0, G_OPTION_ARG_NONE, &pipeline,
+        "Run every case through morsesrc ! fakesink instead of create()", NULL},
+    {"json", 0, 0, G_OPTION_ARG_NONE, &json,
+        "Print one JSON object per case instead of CSV", NULL},
+    {"quick", 'q', 0, G_OPTION_ARG_NONE, &quick,
+        "Small matrix: S16LE/F32LE, 1/2 channels, 44.1/48 kHz, 20 WPM", NULL},
+    {"verify", 0, 0, G_OPTION_ARG_NONE, &verify,
+        "Compare every case against the reference generator", NULL},
+    {"seek", 0, 0, G_OPTION_ARG_INT, &seek,
+        "Where --verify starts the case, in milliseconds (default: 0)", "MS"},
+    {"high-speed", 0, 0, G_OPTION_ARG_NONE, &high_speed,
+        "Set \"high-speed\" on every case", NULL},
+    {"tolerance", 0, 0, G_OPTION_ARG_DOUBLE, &tolerance,
+        "Difference --verify allows on top of one format step, as a fraction of "
+        "full scale, 0 for bit-exact (default: 1e-4)", "T"},
+    {"stress", 0, 0, G_OPTION_ARG_NONE, &stress,
+        "Run every case under random property changes", NULL},
+    {"seed", 0, 0, G_OPTION_ARG_INT, &seed,
+        "Seed of --stress (default: random)", "N"},
+    {"reference", 0, 0, G_OPTION_ARG_FILENAME, &reference_opt,
+        "Check the cases of a corpus file against their expected timing",
+        "FILE"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new ("- measure morsesrc throughput");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("morsebench: %s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (quick) {
+    formats = bench_list (formats_opt, "S16LE,F32LE");
+    channels = bench_list (channels_opt, "1,2");
+    rates = bench_list (rates_opt, "44100,48000");
+    wpms = bench_list (wpm_opt, "20");
+  } else {
+    formats = formats_opt ? bench_list (formats_opt, NULL)
+        : bench_template_formats ();
+    channels = bench_list (channels_opt, "1,2,8");
+    rates = bench_list (rates_opt, "8000,22050,44100,48000,96000,192000");
+    wpms = bench_list (wpm_opt, "5,20,30");
+  }
+  oscillators = bench_list (oscillator_opt, "sin");
+  simds = bench_list (simd_opt, "auto");
+  caches = bench_list (cache_opt, "false");
+
+  if (!formats || !formats[0]) {
+    g_printerr ("morsebench: morsesrc not found, is GST_PLUGIN_PATH set?\n");
+    return 1;
+  }
+
+  if ((verify || reference_opt) && (stress || pipeline)) {
+    g_printerr ("morsebench: --verify and --reference run on their own\n");
+    return 1;
+  }
+  if (seek > 0 && !verify) {
+    g_printerr ("morsebench: --seek needs --verify\n");
+    return 1;
+  }
+  if (reference_opt && !(refs = bench_reference_load (reference_opt)))
+    return 1;
+  if (stress && seed == 0)
+    seed = g_random_int_range (1, G_MAXINT);
+  if (stress)
+    g_printerr ("morsebench: --stress --seed=%d\n", seed);
+
+  if (!json && refs)
+    g_print ("mode,oscillator,simd,symbol_cache,format,channels,rate,wpm,"
+        "samples,result\n");
+  else if (!json && verify)
+    g_print ("mode,oscillator,simd,symbol_cache,format,channels,rate,wpm,"
+        "samples,max_error,allowed,result\n");
+  else if (!json)
+    g_print ("mode,oscillator,simd,symbol_cache,format,channels,rate,wpm,"
+        "buffers,samples,seconds,samples_per_sec,ns_per_sample,"
+        "allocs_per_buffer,realtime\n");
+
+  for (gchar **o = oscillators; *o; o++)
+    for (gchar **s = simds; *s; s++)
+      for (gchar **sc = caches; *sc; sc++)
+        for (guint i = 0; refs && i < refs->len; i++) {
+          const BenchReference *ref = g_ptr_array_index (refs, i);
+          BenchCase c = ref->c;
+          BenchResult result = { 0 };
+          gchar *why = NULL;
+          gboolean ok;
+
+          c.oscillator = *o;
+          c.simd = *s;
+          c.symbol_cache = *sc;
+          ok = bench_run_reference (&c, ref, bench_allowed (c.format,
+                  tolerance), &result, &why);
+          if (ok)
+            bench_report_reference (&c, &result, why, json);
+
+          if (!ok || why) {
+            g_printerr ("morsebench: %s %d ch %d Hz %d WPM failed\n",
+                c.format, c.channels, c.rate, c.wpm);
+            failed++;
+          }
+          g_free (why);
+        }
+
+  for (gchar **o = oscillators; *o && !refs; o++)
+    for (gchar **s = simds; *s; s++)
+      for (gchar **sc = caches; *sc; sc++)
+        for (gchar **f = formats; *f; f++)
+          for (gchar **ch = channels; *ch; ch++)
+            for (gchar **r = rates; *r; r++)
+              for (gchar **w = wpms; *w; w++) {
+                BenchCase c = { *o, *s, *sc, *f, atoi (*ch), atoi (*r),
+                  atoi (*w), NULL, high_speed, seek * GST_MSECOND };
+                BenchResult result = { 0 };
+                gdouble error = 0.0, allowed = bench_allowed (c.format,
+                    tolerance);
+                gboolean ok;
+
+                if (verify) {
+                  ok = bench_run_verify (&c, seconds, &result, &error);
+                  if (ok)
+                    bench_report_verify (&c, &result, error, allowed, json);
+                  ok = ok && error >= 0.0 && error <= allowed;
+                } else if (stress) {
+                  ok = bench_run_stress (&c, seconds, seed, &result);
+                  if (ok)
+                    bench_report (&c, &result, "stress", json);
+                } else {
+                  ok = pipeline
+                      ? bench_run_pipeline (&c, seconds, &result)
+                      : bench_run_create (&c, seconds, &result, NULL);
+                  if (ok)
+                    bench_report (&c, &result,
+                        pipeline ? "pipeline" : "create", json);
+                }
+
+                if (!ok) {
+                  g_printerr ("morsebench: %s %d ch %d Hz %d WPM failed\n",
+                      c.format, c.channels, c.rate, c.wpm);
+                  failed++;
+                }
+              }
+
+  g_strfreev (formats);
+  g_strfreev (channels);
+  g_strfreev (rates);
+  g_strfreev (wpms);
+  g_strfreev (oscillators);
+  g_strfreev (simds);
+  g_strfreev (caches);
+  if (refs)
+    g_ptr_array_unref (refs);
+  g_free (reference_opt);
+
+  return failed > 0;
+}